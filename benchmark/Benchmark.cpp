@@ -0,0 +1,232 @@
+/**
+ * Measures the latency of the route calculation on a real or a synthetic graph.
+ *
+ * Usage:
+ *   ./Benchmark [options]
+ *     --pbf <file> --chargers <csv>  use a real graph (the CH is reused like in the routing program)
+ *     --size <size>                  use a synthetic graph of this size instead, see GenerateSyntheticGraph
+ *     --grid <rows> <cols>           use a synthetic grid graph instead (default 200 x 200)
+ *     --parks <count>                number of synthetic charging parks (default 2000)
+ *     --routes <count>               number of random routes (default 200)
+ *     --seed <seed>                  seed of the graph and the routes (default 1)
+ *     --vehicle <name>               one of the vehicles of the README (default Tesla Model 3 LR)
+ *     --threads <count>              routes are calculated by this many threads (default 1)
+ *     --json <file>                  also write the results as JSON, e.g. to keep a baseline
+ *     --trace <file>                 write a timeline of the routes in the Chrome trace event format
+ *
+ * The origins and destinations are random coordinates a few hundred metres around random nodes of the graph, so the
+ * same seed gives the same routes on the same graph. They are projected onto the nearest arc like the requests of
+ * RoutingService. The latency of each route is broken down into the stages of StageTimer.h.
+ */
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "EvRouting.h"
+#include "Graph.h"
+#include "RoutingService.h"
+#include "StageTimer.h"
+#include "StringUtil.h"
+#include "SyntheticGraph.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "VehicleCatalog.h"
+#include "json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+#define BENCHMARK_OFFSET_DEG 0.003 // The random coordinates lie up to this far from their node (about 300 m in latitude).
+
+struct Sample {
+	StageTimes stages;
+	RouteCounters counters;
+	double latency; // Total time of the route in seconds
+	bool fail;
+};
+
+/**
+ * @brief Discards everything written to it, to keep the log of calculateRoute out of the measurement.
+ */
+struct NullBuffer : streambuf {
+	int overflow(int c) override {
+		return c;
+	}
+};
+
+double percentile(vector<double> values, double p) {
+	if (values.empty())
+		return 0.0;
+	sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(ceil(p / 100.0 * values.size()));
+	return values[min(values.size() - 1, max<size_t>(rank, 1) - 1)];
+}
+
+int main(int argc, char* argv[]) {
+	string pbf_file, charger_file;
+	SyntheticGraphOptions options;
+	size_t routeCount = 200, threadCount = 1;
+	string vehicle = "Tesla Model 3 LR", jsonFile, traceFile;
+	for (int a = 1; a + 1 < argc; ++a)
+		if (string(argv[a]) == "--size")
+			options = SyntheticGraphOptions::preset(argv[a + 1]);
+	for (int a = 1; a < argc; ++a) {
+		string arg = argv[a];
+		auto next = [&]() -> string {
+			if (a + 1 >= argc)
+				throw invalid_argument(arg + " needs a value");
+			return argv[++a];
+		};
+		if (arg == "--pbf") pbf_file = next();
+		else if (arg == "--chargers") charger_file = next();
+		else if (arg == "--size") next();
+		else if (arg == "--grid") { options.rows = stoul(next()); options.cols = stoul(next()); }
+		else if (arg == "--parks") options.chargerCount = stoul(next());
+		else if (arg == "--routes") routeCount = stoul(next());
+		else if (arg == "--seed") options.seed = stoul(next());
+		else if (arg == "--vehicle") vehicle = next();
+		else if (arg == "--threads") threadCount = max(1ul, stoul(next()));
+		else if (arg == "--json") jsonFile = next();
+		else if (arg == "--trace") traceFile = next();
+		else throw invalid_argument("unknown option " + arg);
+	}
+	if (!traceFile.empty())
+		enableTracing();
+
+	GraphSnapshot g;
+	json setup;
+	if (!pbf_file.empty()) {
+		g = Graph::load(pbf_file, charger_file.empty() ? "../data/chargers.csv" : charger_file);
+		setup["graph"] = pbf_file;
+	} else {
+		g = loadSyntheticGraph(options, "synthetic_chargers.csv");
+		setup["graph"] = "grid " + to_string(options.rows) + " x " + to_string(options.cols);
+		setup["parks"] = options.chargerCount;
+	}
+	setup["nodes"] = g->node_count();
+	setup["arcs"] = g->arc_count();
+	setup["routes"] = routeCount;
+	setup["seed"] = options.seed;
+	setup["vehicle"] = vehicle;
+	setup["threads"] = threadCount;
+
+	EvCar car = builtInVehicle(vehicle);
+	auto profile = make_shared<const CompiledVehicleProfile>(car, g->connectorPowers());
+	auto energy = make_shared<const EnergyWeight>(*g, *profile);
+	const SnappingService& snapper = g->snapper();
+
+	// Random coordinates around random nodes, so they lie within the snapping radius even in the gaps of a sparse graph
+	mt19937_64 random(options.seed);
+	uniform_int_distribution<unsigned> nodeOf(0, g->node_count() - 1);
+	uniform_real_distribution<float> offsetOf(-BENCHMARK_OFFSET_DEG, BENCHMARK_OFFSET_DEG);
+	auto randomPosition = [&]() {
+		unsigned node = nodeOf(random);
+		return make_pair(g->latitude[node] + offsetOf(random), g->longitude[node] + offsetOf(random));
+	};
+	vector<pair<float, float>> origins, destinations;
+	for (size_t r = 0; r < routeCount; ++r) {
+		origins.push_back(randomPosition());
+		destinations.push_back(randomPosition());
+	}
+
+	vector<Sample> samples(routeCount);
+	streambuf* log = cout.rdbuf();
+	NullBuffer discard;
+	cout.rdbuf(&discard);
+	auto start_time = chrono::steady_clock::now();
+	{
+		ThreadPool pool(threadCount);
+		for (size_t r = 0; r < routeCount; ++r) {
+			pool.submit([&, r]() {
+				static thread_local QueryContext context;
+				auto route_start = chrono::steady_clock::now();
+				StageTimes stages;
+				ArcSnapResult from, to;
+				{
+					StageTimer timer(stages, STAGE_SNAPPING);
+					from = snapper.snapToArc(origins[r].first, origins[r].second, SNAP_RADIUS_IN_METERS);
+					to = snapper.snapToArc(destinations[r].first, destinations[r].second, SNAP_RADIUS_IN_METERS);
+				}
+				Sample& sample = samples[r];
+				if (!from.ok() || !to.ok()) {
+					sample.fail = true;
+					sample.latency = chrono::duration<double>(chrono::steady_clock::now() - route_start).count();
+					sample.stages = stages;
+					return;
+				}
+				EvRouting routing(g, profile, energy, &context);
+				unique_ptr<Route> route(routing.calculateRoute(from, to, car.currentChargeInKwh));
+				for (int s = 0; s < STAGE_COUNT; ++s)
+					stages.seconds[s] += route->stageTimes.seconds[s];
+				{
+					StageTimer timer(stages, STAGE_SERIALISATION);
+					json result;
+					result["routes"] = { route->toJson() };
+					string text = result.dump();
+				}
+				sample.counters = route->counters;
+				sample.fail = route->fail;
+				sample.latency = chrono::duration<double>(chrono::steady_clock::now() - route_start).count();
+				sample.stages = stages;
+			});
+		}
+	}
+	double wallTime = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	cout.rdbuf(log);
+
+	// Report the percentiles in milliseconds
+	json report;
+	report["setup"] = setup;
+	report["throughputRoutesPerSecond"] = routeCount / wallTime;
+	report["failedRoutes"] = count_if(samples.begin(), samples.end(), [](const Sample& s) { return s.fail; });
+	auto summarise = [&](const string& name, const vector<double>& seconds) {
+		double sum = 0.0;
+		for (double s : seconds)
+			sum += s;
+		report["latencyMs"][name] = {
+			{"mean", 1000 * sum / max<size_t>(1, seconds.size())},
+			{"p50", 1000 * percentile(seconds, 50)},
+			{"p90", 1000 * percentile(seconds, 90)},
+			{"p99", 1000 * percentile(seconds, 99)},
+			{"max", 1000 * percentile(seconds, 100)}
+		};
+	};
+	vector<double> values;
+	for (const Sample& s : samples)
+		values.push_back(s.latency);
+	summarise("total", values);
+	for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+		values.clear();
+		for (const Sample& s : samples)
+			values.push_back(s.stages.seconds[stage]);
+		summarise(ROUTE_STAGE_NAMES[stage], values);
+	}
+
+	RouteCounters totalCounters;
+	for (const Sample& s : samples)
+		totalCounters += s.counters;
+	for (int c = 0; c < COUNTER_COUNT; ++c)
+		report["countersPerRoute"][ROUTE_COUNTER_NAMES[c]] = double(totalCounters.values[c]) / max<size_t>(1, routeCount);
+
+	cout << routeCount << " routes on " << setup["graph"].get<string>() << " (" << g->node_count() << " nodes, " << g->chargers.size() << " parks), "
+		<< report["failedRoutes"] << " failed, " << fixed << setprecision(1) << report["throughputRoutesPerSecond"].get<double>() << " routes/s with " << threadCount << " threads" << endl;
+	cout << left << setw(18) << "stage (ms)" << right << setw(10) << "mean" << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "max" << endl;
+	cout << setprecision(3);
+	for (auto& [name, stats] : report["latencyMs"].items())
+		cout << left << setw(18) << name << right << setw(10) << stats["mean"].get<double>() << setw(10) << stats["p50"].get<double>() << setw(10) << stats["p90"].get<double>()
+			<< setw(10) << stats["p99"].get<double>() << setw(10) << stats["max"].get<double>() << endl;
+	cout << "per route:";
+	for (int c = 0; c < COUNTER_COUNT; ++c)
+		cout << " " << ROUTE_COUNTER_NAMES[c] << " " << setprecision(1) << report["countersPerRoute"][ROUTE_COUNTER_NAMES[c]].get<double>();
+	cout << endl;
+	if (!jsonFile.empty())
+		ofstream(jsonFile) << report.dump(2) << endl;
+	if (!traceFile.empty())
+		writeChromeTrace(traceFile);
+	return 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file ArrayView.h
+ * @brief Defines a read-only view on a contiguous array that is owned by someone else, e.g. a std::vector or a memory-mapped file.
+ */
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+template<class T>
+struct ArrayView {
+	const T* first = nullptr;
+	size_t count = 0;
+
+	ArrayView() {}
+	ArrayView(const T* _first, size_t _count) : first{_first}, count{_count} {}
+	ArrayView(const vector<T>& v) : first{v.data()}, count{v.size()} {}
+
+	const T& operator[](size_t i) const { return first[i]; }
+	const T* data() const { return first; }
+	const T* begin() const { return first; }
+	const T* end() const { return first + count; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const T& back() const { return first[count - 1]; }
+
+	/**
+	 * @brief Copies the viewed elements, e.g. for RoutingKit functions that only accept vectors.
+	 */
+	vector<T> toVector() const { return vector<T>(begin(), end()); }
+};
@@ -0,0 +1,72 @@
+/**
+ * @file BatchRouting.h
+ * @brief Routes a JSONL file of requests on a thread pool and writes the results as NDJSON in the order of the input.
+ * The input is streamed: at most a few requests per worker are in flight, so the file can be arbitrarily long.
+ */
+#pragma once
+
+#include "RoutingService.h"
+#include "ThreadPool.h"
+#include "json.hpp"
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+
+using json = nlohmann::json;
+using namespace std;
+
+#define BATCH_REQUESTS_PER_WORKER 4 // Requests that are queued per worker before the oldest result is written.
+
+/**
+ * @brief Routes all requests of a JSONL file, see RoutingService::route() for the format of a line.
+ *
+ * @param service The service that calculates the routes
+ * @param requestFile One JSON request per line, empty lines are skipped
+ * @param resultFile Receives one JSON result per request in the same order
+ * @param threadCount The number of worker threads, 0 uses one per hardware thread
+ * @return The number of requests that failed.
+ */
+inline size_t runBatch(RoutingService& service, string requestFile, string resultFile, size_t threadCount = 0) {
+	ifstream input(requestFile);
+	if (!input)
+		throw runtime_error("cannot read " + requestFile);
+	ofstream output(resultFile);
+	if (!output)
+		throw runtime_error("cannot write " + resultFile);
+	auto start_time = chrono::high_resolution_clock::now();
+	ThreadPool pool(threadCount);
+	deque<future<json>> pending;
+	size_t count = 0, failed = 0;
+	auto writeOldest = [&]() {
+		json result = pending.front().get();
+		pending.pop_front();
+		if (result.contains("error") || (result.contains("routes") && result["routes"][0].contains("fail")))
+			++failed;
+		output << result.dump() << '\n';
+	};
+	string line;
+	size_t lineNumber = 0;
+	while (getline(input, line)) {
+		++lineNumber;
+		if (line.find_first_not_of(" \t\r") == string::npos)
+			continue;
+		pending.push_back(pool.submit([&service, line, lineNumber]() {
+			json request = json::parse(line, nullptr, false);
+			if (request.is_discarded())
+				return json{{"line", lineNumber}, {"error", "invalid JSON"}};
+			return service.route(request);
+		}));
+		++count;
+		if (pending.size() >= BATCH_REQUESTS_PER_WORKER * pool.size())
+			writeOldest();
+	}
+	while (!pending.empty())
+		writeOldest();
+	auto finish_time = chrono::high_resolution_clock::now();
+	auto duration = chrono::duration_cast<chrono::milliseconds>(finish_time - start_time);
+	cout << "Routed " << count << " requests (" << failed << " failed) with " << pool.size() << " threads in " << duration.count() << " ms." << endl;
+	return failed;
+}
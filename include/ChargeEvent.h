@@ -5,15 +5,16 @@
  * as well as the required charging information.
  */
 #pragma once
-#include "ChargingPark.h"
+#include "ChargerStore.h"
 #include "ChargingConnector.h"
 #include "json.hpp"
 using json = nlohmann::json;
 
 struct ChargeEvent {
-	ChargeEvent(ChargingPark* _park, ChargingConnector* _connector) : park{_park}, connector{_connector} {}
-	ChargingPark* park;
-	ChargingConnector* connector;
+	ChargeEvent(const ChargerStore* _chargers, unsigned _park, const ChargingConnector* _connector) : chargers{_chargers}, park{_park}, connector{_connector} {}
+	const ChargerStore* chargers; // Borrowed from the graph of the route
+	unsigned park; // Position of the park in chargers
+	const ChargingConnector* connector;
 	int chargingTimeInSeconds = 0;
 	float remainingChargeAtArrivalInkWh = 0.0;
 	float targetChargeInkWh = 0.0;
@@ -34,7 +35,7 @@ struct ChargeEvent {
 			{"targetChargeInkWh", targetChargeInkWh},
 			{"chargingConnectionInfo", connector->toJson()}
 		};
-		result["chargingInformationAtEndOfLeg"].merge_patch(park->toJson());
+		result["chargingInformationAtEndOfLeg"].merge_patch(chargers->toJson(park));
 		result["chargingConnectionInfo"] = connector->toJson();
 		return result;
 	}
@@ -0,0 +1,154 @@
+/**
+ * @file ChargerCsv.h
+ * @brief Parses the chargers.csv of gatherEVStations.py straight from a mapped file.
+ * The fields are string views into the file and the numbers are read with from_chars, so a row costs no allocation
+ * until its charging park is created. Large files are split at line breaks and parsed in parallel.
+ */
+#pragma once
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define CHARGER_CSV_FIELDS 9 // id,name,entry_lat,entry_lon,lat,lon,kws,types,currentTypes
+#define CHARGER_CSV_CHUNK_BYTES (1 << 20) // Smaller files are parsed on the calling thread.
+
+/**
+ * @brief One row of the csv file. The views point into the mapped file.
+ */
+struct ChargerCsvRow {
+	string_view fields[CHARGER_CSV_FIELDS];
+
+	string_view id() const { return fields[0]; }
+	string_view name() const { return fields[1]; }
+	string_view entryLat() const { return fields[2]; }
+	string_view entryLon() const { return fields[3]; }
+	string_view lat() const { return fields[4]; }
+	string_view lon() const { return fields[5]; }
+	string_view kws() const { return fields[6]; }
+	string_view types() const { return fields[7]; }
+	string_view currentTypes() const { return fields[8]; }
+};
+
+/**
+ * @brief Reads a whole field as a number.
+ *
+ * @return false if the field is not a number or has trailing characters.
+ */
+template<class T>
+inline bool parseCsvNumber(string_view field, T& value) {
+	auto result = from_chars(field.data(), field.data() + field.size(), value);
+	return result.ec == errc() && result.ptr == field.data() + field.size();
+}
+
+/**
+ * @brief Splits a field like "11|50|150" into its non-empty parts.
+ *
+ * @param field The field
+ * @param parts Filled with the parts, it is cleared first so the caller can reuse it.
+ */
+inline void splitCsvList(string_view field, vector<string_view>& parts) {
+	parts.clear();
+	size_t start = 0;
+	while (start < field.size()) {
+		size_t end = field.find('|', start);
+		if (end == string_view::npos)
+			end = field.size();
+		if (end > start)
+			parts.push_back(field.substr(start, end - start));
+		start = end + 1;
+	}
+}
+
+/**
+ * @brief Splits a line into the fields of a row.
+ *
+ * @return false if the line has fewer fields. Further fields are ignored.
+ */
+inline bool splitCsvRow(string_view line, ChargerCsvRow& row) {
+	if (!line.empty() && line.back() == '\r')
+		line.remove_suffix(1);
+	size_t start = 0;
+	for (int f = 0; f < CHARGER_CSV_FIELDS; ++f) {
+		if (start > line.size())
+			return false;
+		size_t end = min(line.find(',', start), line.size());
+		row.fields[f] = line.substr(start, end - start);
+		start = end + 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Calls parseRow for every row of a part of the file.
+ *
+ * @param text The lines to parse, without the header
+ * @param parseRow Called with each row in the order of the file
+ */
+template<class ParseRow>
+inline void forEachChargerCsvRow(string_view text, ParseRow& parseRow) {
+	ChargerCsvRow row;
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == string_view::npos)
+			end = text.size();
+		if (splitCsvRow(text.substr(start, end - start), row))
+			parseRow(row);
+		start = end + 1;
+	}
+}
+
+/**
+ * @brief Parses a charger csv file, in parallel chunks if it is large.
+ * Every chunk is parsed into its own vector, and the vectors are concatenated in the order of the file, so the result
+ * does not depend on the number of threads.
+ *
+ * @param path The csv file, its first line is the header
+ * @param parseRow Called with a row and the vector of its chunk. It must be safe to call from several threads.
+ * @return The results of all rows in the order of the file.
+ */
+template<class Result, class ParseRow>
+vector<Result> parseChargerCsv(const string& path, const ParseRow& parseRow) {
+	MappedFile file(path);
+	string_view text(file.data(), file.size());
+	size_t headerEnd = text.find('\n');
+	text = headerEnd == string_view::npos ? string_view() : text.substr(headerEnd + 1);
+	// Split at the line breaks after every CHARGER_CSV_CHUNK_BYTES
+	vector<string_view> chunks;
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = start + CHARGER_CSV_CHUNK_BYTES < text.size() ? text.find('\n', start + CHARGER_CSV_CHUNK_BYTES) : string_view::npos;
+		end = end == string_view::npos ? text.size() : end + 1;
+		chunks.push_back(text.substr(start, end - start));
+		start = end;
+	}
+	vector<vector<Result>> parsed(chunks.size());
+	auto parseChunk = [&](size_t c) {
+		auto collect = [&](const ChargerCsvRow& row) { parseRow(row, parsed[c]); };
+		forEachChargerCsvRow(chunks[c], collect);
+	};
+	if (chunks.size() <= 1) {
+		if (!chunks.empty())
+			parseChunk(0);
+	} else {
+		ThreadPool pool(min<size_t>(chunks.size(), max(1u, thread::hardware_concurrency())));
+		vector<future<void>> done;
+		for (size_t c = 0; c < chunks.size(); ++c)
+			done.push_back(pool.submit([&, c] { parseChunk(c); }));
+		for (auto& chunk : done)
+			chunk.get(); // Rethrows the exceptions of the workers
+	}
+	vector<Result> results;
+	for (auto& chunk : parsed)
+		results.insert(results.end(), chunk.begin(), chunk.end());
+	return results;
+}
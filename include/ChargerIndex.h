@@ -0,0 +1,303 @@
+/**
+ * @file ChargerIndex.h
+ * @brief Defines a uniform grid over the locations of the charging parks.
+ * The parks are stored cell by cell, so k-nearest and radius queries only look at the cells around the query point
+ * instead of scanning every park. Within a cell the parks are ordered by the power tier of their best connector, so a
+ * query for parks with at least some power skips the slower tiers, e.g. the many AC points of a city when only fast
+ * chargers are wanted.
+ */
+#pragma once
+
+#include "ChargerStore.h"
+#include "DistanceKernel.h"
+#include "Point.h"
+#include "RouteCounters.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+#define CHARGER_INDEX_CELL_DEG 0.1 // Edge length of a grid cell in degrees (about 11 km in latitude).
+#define CHARGER_POWER_TIERS 4
+
+inline const float CHARGER_TIER_MIN_KW[CHARGER_POWER_TIERS] = {0, 50, 150, 300}; // The lowest power of each tier
+
+/**
+ * @brief Returns the power tier of a charging power.
+ *
+ * @param kw The charging power in kW
+ * @return The highest tier whose lowest power is at most kw.
+ */
+inline unsigned powerTier(float kw) {
+	unsigned tier = 0;
+	while (tier + 1 < CHARGER_POWER_TIERS && CHARGER_TIER_MIN_KW[tier + 1] <= kw)
+		++tier;
+	return tier;
+}
+
+/**
+ * @brief A charging park found along a route together with the route position it is closest to.
+ */
+struct CorridorHit {
+	unsigned park; // Position of the park in the ChargerStore
+	unsigned position; // Index of the closest point of the route
+	double distanceInKm; // Distance between the park and that point
+	float socInKwh = 0.0; // State of charge of the vehicle at that point
+};
+
+struct ChargerIndex {
+	double latMin = 0.0, lonMin = 0.0, latMax = 0.0, lonMax = 0.0;
+	int rows = 0, cols = 0;
+	vector<unsigned> cellFirst; // The parks of tier t in cell c are order[cellFirst[slot(c, t)]] to order[cellFirst[slot(c, t) + 1] - 1].
+	vector<unsigned> order; // Position of each park of the grid in the ChargerStore, also used to break ties.
+	vector<double> lat, lon; // Coordinates of the parks in the order of the grid, so a scan reads them sequentially.
+	vector<float> kw; // The best charging power of the parks in the order of the grid
+
+	/**
+	 * @brief Builds the grid over the given charging parks.
+	 *
+	 * @param chargers The parks to index
+	 */
+	void build(const ChargerStore& chargers) {
+		*this = ChargerIndex();
+		if (chargers.empty())
+			return;
+		latMin = *min_element(chargers.lat.begin(), chargers.lat.end());
+		latMax = *max_element(chargers.lat.begin(), chargers.lat.end());
+		lonMin = *min_element(chargers.lon.begin(), chargers.lon.end());
+		lonMax = *max_element(chargers.lon.begin(), chargers.lon.end());
+		rows = static_cast<int>((latMax - latMin) / CHARGER_INDEX_CELL_DEG) + 1;
+		cols = static_cast<int>((lonMax - lonMin) / CHARGER_INDEX_CELL_DEG) + 1;
+		// Counting sort of the parks by cell and tier
+		vector<unsigned> slotOf(chargers.size());
+		cellFirst.assign(rows * cols * CHARGER_POWER_TIERS + 1, 0);
+		for (size_t i = 0; i < chargers.size(); ++i) {
+			slotOf[i] = slot(cell(row(chargers.lat[i]), col(chargers.lon[i])), powerTier(chargers.bestKw[i]));
+			++cellFirst[slotOf[i] + 1];
+		}
+		for (size_t s = 0; s + 1 < cellFirst.size(); ++s)
+			cellFirst[s + 1] += cellFirst[s];
+		vector<unsigned> next(cellFirst.begin(), cellFirst.end() - 1);
+		order.resize(chargers.size());
+		lat.resize(chargers.size());
+		lon.resize(chargers.size());
+		kw.resize(chargers.size());
+		for (size_t i = 0; i < chargers.size(); ++i) {
+			unsigned pos = next[slotOf[i]]++;
+			order[pos] = i;
+			lat[pos] = chargers.lat[i];
+			lon[pos] = chargers.lon[i];
+			kw[pos] = chargers.bestKw[i];
+		}
+	}
+
+	/**
+	 * @brief Restores a grid that was built before, e.g. from a charger catalog, without sorting the parks again.
+	 *
+	 * @param chargers The parks the grid was built from
+	 * @param _cellFirst The first park of each cell, see cellFirst
+	 * @param _order The position of each park of the grid in chargers, see order
+	 */
+	void restore(const ChargerStore& chargers, double _latMin, double _lonMin, double _latMax, double _lonMax, int _rows, int _cols, vector<unsigned> _cellFirst, vector<unsigned> _order) {
+		*this = ChargerIndex();
+		latMin = _latMin, lonMin = _lonMin, latMax = _latMax, lonMax = _lonMax;
+		rows = _rows, cols = _cols;
+		cellFirst = move(_cellFirst);
+		order = move(_order);
+		lat.resize(order.size());
+		lon.resize(order.size());
+		kw.resize(order.size());
+		for (size_t pos = 0; pos < order.size(); ++pos) {
+			lat[pos] = chargers.lat[order[pos]];
+			lon[pos] = chargers.lon[order[pos]];
+			kw[pos] = chargers.bestKw[order[pos]];
+		}
+	}
+
+	int row(double latitude) const {
+		return static_cast<int>(floor((latitude - latMin) / CHARGER_INDEX_CELL_DEG));
+	}
+
+	int col(double longitude) const {
+		return static_cast<int>(floor((longitude - lonMin) / CHARGER_INDEX_CELL_DEG));
+	}
+
+	unsigned cell(int r, int c) const {
+		return r * cols + c;
+	}
+
+	/**
+	 * @brief Returns the position of the parks of a tier of a cell in cellFirst.
+	 * The tiers of a cell and the cells of a row follow each other, so slot(c, 0) to slot(c + 1, 0) are all parks of c.
+	 */
+	unsigned slot(unsigned cellId, unsigned tier) const {
+		return cellId * CHARGER_POWER_TIERS + tier;
+	}
+
+	/**
+	 * @brief Finds the k nearest charging parks within a maximum distance.
+	 *
+	 * @param p The query point
+	 * @param k The maximum number of parks to return
+	 * @param maxDistInKm Parks that are further away are ignored
+	 * @param minKw Parks whose best connector has less power are ignored
+	 * @return The parks sorted by their distance to p (ties by their position in the store).
+	 */
+	vector<unsigned> findKNearest(Point* p, size_t k, double maxDistInKm, float minKw = 0.0) const {
+		vector<pair<long double, unsigned>> best; // max-heap of (distance, position in the grid)
+		if (order.empty() || k == 0)
+			return {};
+		auto closer = [this](const pair<long double, unsigned>& a, const pair<long double, unsigned>& b) {
+			return a.first < b.first || (a.first == b.first && order[a.second] < order[b.second]);
+		};
+		// Longitude degrees are shortest at the latitude closest to a pole.
+		double lonScale = cos(toRadians(min(90.0, max(max(fabs(latMin), fabs(latMax + CHARGER_INDEX_CELL_DEG)), fabs(p->lat)))));
+		uint64_t scanned = 0, haversines = 0;
+		vector<unsigned> survivors;
+		unsigned minTier = powerTier(minKw);
+		auto visitCell = [&](int r, int c) {
+			if (r < 0 || c < 0 || r >= rows || c >= cols)
+				return;
+			unsigned first = cellFirst[slot(cell(r, c), minTier)], last = cellFirst[slot(cell(r, c) + 1, 0)]; // The tiers from minTier on
+			scanned += last - first;
+			// Only the parks that can be closer than the k-th best park so far get the exact distance.
+			double bound = best.size() == k ? min<double>(maxDistInKm, best.front().first) : maxDistInKm;
+			survivors.clear();
+			filterByFlatDistance(lat.data(), lon.data(), first, last, p->lat, p->lon, lonScale, flatDistanceBound(bound), survivors);
+			for (unsigned i : survivors) {
+				if (kw[i] < minKw) // The lowest tier of the query can contain slower parks
+					continue;
+				++haversines;
+				long double dist = distance_in_km(p->lat, p->lon, lat[i], lon[i]);
+				if (dist > maxDistInKm)
+					continue;
+				pair<long double, unsigned> candidate = make_pair(dist, i);
+				if (best.size() < k) {
+					best.push_back(candidate);
+					push_heap(best.begin(), best.end(), closer);
+				} else if (closer(candidate, best.front())) {
+					pop_heap(best.begin(), best.end(), closer);
+					best.back() = candidate;
+					push_heap(best.begin(), best.end(), closer);
+				}
+			}
+		};
+		int r0 = row(p->lat), c0 = col(p->lon);
+		int lastRing = max(max(abs(r0), abs(rows - 1 - r0)), max(abs(c0), abs(cols - 1 - c0)));
+		for (int ring = 0; ring <= lastRing; ++ring) {
+			if (ring > 0) {
+				// Every cell of this ring lies outside the square of the previous rings. 0.99 covers the error of the flat approximation.
+				double latGap = min(p->lat - (latMin + (r0 - ring + 1) * CHARGER_INDEX_CELL_DEG), latMin + (r0 + ring) * CHARGER_INDEX_CELL_DEG - p->lat);
+				double lonGap = min(p->lon - (lonMin + (c0 - ring + 1) * CHARGER_INDEX_CELL_DEG), lonMin + (c0 + ring) * CHARGER_INDEX_CELL_DEG - p->lon);
+				double lowerBound = 0.99 * KM_PER_DEG * min(latGap, lonGap * lonScale);
+				if (lowerBound > maxDistInKm || (best.size() == k && lowerBound > best.front().first))
+					break;
+			}
+			if (ring == 0) {
+				visitCell(r0, c0);
+				continue;
+			}
+			for (int c = c0 - ring; c <= c0 + ring; ++c) {
+				visitCell(r0 - ring, c);
+				visitCell(r0 + ring, c);
+			}
+			for (int r = r0 - ring + 1; r <= r0 + ring - 1; ++r) {
+				visitCell(r, c0 - ring);
+				visitCell(r, c0 + ring);
+			}
+		}
+		countRouteEvent(COUNTER_PARKS_SCANNED, scanned);
+		countRouteEvent(COUNTER_HAVERSINES, haversines);
+		sort_heap(best.begin(), best.end(), closer);
+		vector<unsigned> result;
+		result.reserve(best.size());
+		for (auto& entry : best)
+			result.push_back(order[entry.second]);
+		return result;
+	}
+
+	/**
+	 * @brief Walks a polyline from its last point to its first and reports the charging parks within a buffer around
+	 * each point. Each park is reported once, at the last point of the polyline it lies within the buffer of.
+	 * The caller raises the minimum power as the sweep goes on, e.g. to the power of the best park found so far. The
+	 * slower tiers of the cells are then not scanned at all, and the sweep stops as soon as the caller is done.
+	 *
+	 * @param pointCount The number of points of the polyline
+	 * @param pointAt Returns the (latitude, longitude) of the i-th point
+	 * @param bufferInKm The maximum distance between a park and the polyline
+	 * @param visit Called with the index of each point and its new parks, sorted by their distance to the point.
+	 * It returns the minimum power of the parks to report at the following points, or a negative value to stop.
+	 */
+	template<class PointAt, class Visit>
+	void sweepAlongPolyline(size_t pointCount, const PointAt& pointAt, double bufferInKm, const Visit& visit) const {
+		unordered_set<unsigned> reported; // positions in the grid
+		double lonScale = cos(toRadians(min(90.0, max(fabs(latMin), fabs(latMax + CHARGER_INDEX_CELL_DEG)))));
+		int rowReach = static_cast<int>(ceil(bufferInKm / (KM_PER_DEG * CHARGER_INDEX_CELL_DEG)));
+		int colReach = static_cast<int>(ceil(bufferInKm / (KM_PER_DEG * CHARGER_INDEX_CELL_DEG * lonScale)));
+		double maxSquaredDeg = flatDistanceBound(bufferInKm);
+		uint64_t scanned = 0, haversines = 0;
+		vector<unsigned> survivors;
+		vector<CorridorHit> hits;
+		float minKw = 0.0;
+		for (size_t i = pointCount; i-- > 0 && minKw >= 0;) {
+			hits.clear();
+			pair<double, double> point = pointAt(i);
+			int r0 = row(point.first), c0 = col(point.second);
+			if (order.empty() || r0 + rowReach < 0 || r0 - rowReach >= rows || c0 + colReach < 0 || c0 - colReach >= cols) {
+				minKw = visit(i, hits);
+				continue;
+			}
+			double pointLonScale = cos(toRadians(point.first));
+			unsigned minTier = powerTier(minKw);
+			survivors.clear();
+			for (int r = max(0, r0 - rowReach); r <= min(rows - 1, r0 + rowReach); ++r) {
+				int cFirst = max(0, c0 - colReach), cLast = min(cols - 1, c0 + colReach);
+				// Cheap flat distance to reject far parks, the exact distance is only computed for the rest.
+				if (minTier == 0) { // The cells of a row are contiguous.
+					unsigned first = cellFirst[slot(cell(r, cFirst), 0)], last = cellFirst[slot(cell(r, cLast) + 1, 0)];
+					scanned += last - first;
+					filterByFlatDistance(lat.data(), lon.data(), first, last, point.first, point.second, pointLonScale, maxSquaredDeg, survivors);
+					continue;
+				}
+				for (int c = cFirst; c <= cLast; ++c) { // Only the tiers from minTier on
+					unsigned first = cellFirst[slot(cell(r, c), minTier)], last = cellFirst[slot(cell(r, c) + 1, 0)];
+					scanned += last - first;
+					filterByFlatDistance(lat.data(), lon.data(), first, last, point.first, point.second, pointLonScale, maxSquaredDeg, survivors);
+				}
+			}
+			for (unsigned p : survivors) {
+				if (kw[p] < minKw || reported.count(p)) // The lowest tier of the query can contain slower parks
+					continue;
+				++haversines;
+				long double dist = distance_in_km(point.first, point.second, lat[p], lon[p]);
+				if (dist > bufferInKm)
+					continue;
+				reported.insert(p);
+				hits.push_back({order[p], static_cast<unsigned>(i), static_cast<double>(dist)});
+			}
+			sort(hits.begin(), hits.end(), [](const CorridorHit& a, const CorridorHit& b) {
+				if (a.distanceInKm != b.distanceInKm)
+					return a.distanceInKm < b.distanceInKm;
+				return a.park < b.park;
+			});
+			minKw = visit(i, hits);
+		}
+		countRouteEvent(COUNTER_PARKS_SCANNED, scanned);
+		countRouteEvent(COUNTER_HAVERSINES, haversines);
+	}
+
+	/**
+	 * @brief Finds all charging parks within a radius.
+	 *
+	 * @param p The query point
+	 * @param radiusInKm The search radius
+	 * @param minKw Parks whose best connector has less power are ignored
+	 * @return The parks sorted by their distance to p.
+	 */
+	vector<unsigned> findWithinRadius(Point* p, double radiusInKm, float minKw = 0.0) const {
+		return findKNearest(p, numeric_limits<size_t>::max(), radiusInKm, minKw);
+	}
+};
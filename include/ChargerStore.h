@@ -0,0 +1,105 @@
+/**
+ * @file ChargerStore.h
+ * @brief Stores all charging parks of a graph as a struct of arrays.
+ * A park is identified by its position in the store. Its coordinates, node and best charging power lie in dense
+ * arrays, so the candidate filtering of a route scans a few arrays instead of chasing a pointer per park and per
+ * connector. The connectors of all parks are kept in one flat array, and the best connector of each park is
+ * precomputed when the park is added.
+ */
+#pragma once
+#include "ChargingConnector.h"
+#include "CompiledVehicleProfile.h"
+#include "json.hpp"
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+using json = nlohmann::json;
+
+using namespace std;
+
+struct ChargerStore {
+	vector<long long> ids; // The ids of the parks in the csv file
+	vector<double> lat, lon; // The location of the parks
+	vector<unsigned> node; // The node each park is snapped to
+	vector<float> bestKw; // The highest ratedPowerKw of the connectors of each park
+	vector<unsigned> bestConnector; // The position of that connector in connectors
+	vector<unsigned> connectorFirst{0}; // The connectors of park p are connectors[connectorFirst[p]] to connectors[connectorFirst[p + 1] - 1].
+	vector<ChargingConnector> connectors;
+	vector<unsigned> nameFirst{0}; // The name of park p is names[nameFirst[p]] to names[nameFirst[p + 1] - 1].
+	string names;
+
+	size_t size() const {
+		return ids.size();
+	}
+
+	bool empty() const {
+		return ids.empty();
+	}
+
+	/**
+	 * @brief Adds a park with its connectors.
+	 *
+	 * @param id The id of the park
+	 * @param name The name of the park
+	 * @param latitude The latitude of the park
+	 * @param longitude The longitude of the park
+	 * @param _node The node the park is snapped to
+	 * @param parkConnectors The connectors of the park, at least one
+	 * @return The position of the park in the store, throws invalid_argument if the park has no connectors.
+	 */
+	unsigned add(long long id, string_view name, double latitude, double longitude, unsigned _node, const vector<ChargingConnector>& parkConnectors) {
+		if (parkConnectors.empty())
+			throw invalid_argument("charging park " + to_string(id) + " has no connectors");
+		unsigned park = ids.size();
+		ids.push_back(id);
+		names.append(name.data(), name.size());
+		nameFirst.push_back(names.size());
+		lat.push_back(latitude);
+		lon.push_back(longitude);
+		node.push_back(_node);
+		unsigned first = connectors.size(), best = first;
+		connectors.insert(connectors.end(), parkConnectors.begin(), parkConnectors.end());
+		for (unsigned c = first + 1; c < connectors.size(); ++c) // The first connector with the highest power wins
+			if (connectors[c].ratedPowerKw > connectors[best].ratedPowerKw)
+				best = c;
+		connectorFirst.push_back(connectors.size());
+		bestConnector.push_back(best);
+		bestKw.push_back(connectors[best].ratedPowerKw);
+		return park;
+	}
+
+	string_view name(unsigned park) const {
+		return string_view(names.data() + nameFirst[park], nameFirst[park + 1] - nameFirst[park]);
+	}
+
+	/**
+	 * @brief Get the best Charging Connector of a park.
+	 * Adapt this method if you want to limit the vehicle to certain connection types!
+	 *
+	 * @param park The park
+	 * @param profile The vehicle to charge (CURRENTLY NOT USED!!!)
+	 * @return The connector with the highest ratedPowerKw for the vehicle.
+	 */
+	const ChargingConnector& bestConnectorFor(unsigned park, const CompiledVehicleProfile& /* profile */) const {
+		return connectors[bestConnector[park]];
+	}
+
+	/**
+	 * @brief Get the charging power of the best connector of a park for the vehicle, see bestConnectorFor().
+	 */
+	float bestKwFor(unsigned park, const CompiledVehicleProfile& /* profile */) const {
+		return bestKw[park];
+	}
+
+	json toJson(unsigned park) const {
+		json result;
+		result["chargingParkName"] = string(name(park));
+		result["chargingParkExternalId"] = ids[park];
+		result["chargingParkLocation"] = {{"latitude", lat[park]}, {"longitude", lon[park]}};
+		result["ratedPowerKw"] = static_cast<double>(bestKw[park]);
+		for (unsigned c = connectorFirst[park]; c < connectorFirst[park + 1]; ++c)
+			result["connectors"] += connectors[c].toJson();
+		return result;
+	}
+};
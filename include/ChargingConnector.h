@@ -15,7 +15,7 @@ struct ChargingConnector {
 	string currentType;
 	ChargingConnector(string _connectorType, float _ratedPowerKw, string _currentType) : connectorType{ _connectorType }, ratedPowerKw{ _ratedPowerKw }, currentType{ _currentType} {}
 
-	json toJson() {
+	json toJson() const {
 		json result = {
 			{"connectorType", connectorType},
 			{"ratedPowerKW", ratedPowerKw},
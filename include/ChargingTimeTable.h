@@ -0,0 +1,170 @@
+/**
+ * @file ChargingTimeTable.h
+ * @brief Integrates a piecewise linear charging curve in closed form.
+ * On each segment the charging power is linear in the state of charge, so the time to charge from one SoC to another
+ * is a logarithm and its inverse an exponential. The table stores the cumulative charging time at each breakpoint,
+ * so both directions are answered with one binary search.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct ChargingTimeTable {
+	struct Segment {
+		double socInKwh; // State of charge at the start of the segment
+		double powerInKw; // Charging power at the start of the segment
+		double slope; // Change of the charging power per kWh of charge
+		double secondsFromZero; // Time to charge from 0 kWh to the start of the segment
+	};
+	vector<Segment> segments; // The last segment extends to infinity with constant power.
+
+	ChargingTimeTable() {}
+
+	/**
+	 * @brief Builds the table for a charging curve with the power capped by the connector.
+	 *
+	 * @param curve Pairs of (stateOfChargeInkWh, powerInKw), sorted by SoC and starting at 0 kWh
+	 * @param maxPowerInKw The rated power of the connector
+	 */
+	ChargingTimeTable(const vector<pair<float, float>>& curve, float maxPowerInKw) {
+		auto addSegment = [&](double soc, double power, double slope) {
+			double seconds = segments.empty() ? 0.0 : segments.back().secondsFromZero + secondsWithin(segments.back(), soc);
+			segments.push_back({soc, power, slope, seconds});
+		};
+		for (size_t i = 0; i + 1 < curve.size(); ++i) {
+			double s0 = curve[i].first, s1 = curve[i + 1].first;
+			double p0 = curve[i].second, p1 = curve[i + 1].second;
+			if (s1 <= s0)
+				continue;
+			double slope = (p1 - p0) / (s1 - s0);
+			bool capped0 = p0 >= maxPowerInKw, capped1 = p1 >= maxPowerInKw;
+			if (capped0 && capped1) {
+				addSegment(s0, maxPowerInKw, 0.0);
+			} else if (!capped0 && !capped1) {
+				addSegment(s0, p0, slope);
+			} else { // The curve crosses the cap within this segment
+				double crossing = s0 + (maxPowerInKw - p0) / slope;
+				if (capped0) {
+					addSegment(s0, maxPowerInKw, 0.0);
+					addSegment(crossing, maxPowerInKw, slope);
+				} else {
+					addSegment(s0, p0, slope);
+					addSegment(crossing, maxPowerInKw, 0.0);
+				}
+			}
+		}
+		double lastSoc = curve.empty() ? 0.0 : curve.back().first;
+		double lastPower = curve.empty() ? 0.0 : min<double>(curve.back().second, maxPowerInKw);
+		addSegment(lastSoc, lastPower, 0.0);
+	}
+
+	/**
+	 * @brief Time to charge from the start of a segment to a SoC within it. Infinite if the power drops to zero before.
+	 */
+	static double secondsWithin(const Segment& seg, double soc) {
+		double delta = soc - seg.socInKwh;
+		if (delta <= 0.0)
+			return 0.0;
+		if (seg.powerInKw <= 0.0)
+			return numeric_limits<double>::infinity();
+		if (fabs(seg.slope) < 1e-9)
+			return 3600.0 * delta / seg.powerInKw;
+		double endPower = seg.powerInKw + seg.slope * delta;
+		if (endPower <= 0.0)
+			return numeric_limits<double>::infinity();
+		return 3600.0 * log(endPower / seg.powerInKw) / seg.slope;
+	}
+
+	/**
+	 * @brief SoC after charging for some seconds from the start of a segment (assuming the segment does not end).
+	 */
+	static double socWithin(const Segment& seg, double seconds) {
+		if (fabs(seg.slope) < 1e-9)
+			return seg.socInKwh + seg.powerInKw * seconds / 3600.0;
+		return seg.socInKwh + seg.powerInKw * (exp(seg.slope * seconds / 3600.0) - 1.0) / seg.slope;
+	}
+
+	/**
+	 * @brief Time to charge from 0 kWh to the given SoC.
+	 *
+	 * @param soc The state of charge in kWh
+	 * @return The time in seconds, infinite if the SoC can never be reached.
+	 */
+	double secondsUntil(double soc) const {
+		auto next = upper_bound(segments.begin(), segments.end(), soc, [](double s, const Segment& seg) { return s < seg.socInKwh; });
+		const Segment& seg = next == segments.begin() ? segments.front() : *(next - 1);
+		return seg.secondsFromZero + secondsWithin(seg, soc);
+	}
+
+	/**
+	 * @brief Time to charge from one SoC to another.
+	 *
+	 * @param fromSoc The SoC at the start of charging
+	 * @param toSoc The SoC to charge to
+	 * @return The time in seconds, infinite if toSoc can never be reached.
+	 */
+	double secondsBetween(double fromSoc, double toSoc) const {
+		if (toSoc <= fromSoc)
+			return 0.0;
+		return secondsUntil(toSoc) - secondsUntil(fromSoc);
+	}
+
+	/**
+	 * @brief SoC after charging for a given time.
+	 *
+	 * @param fromSoc The SoC at the start of charging
+	 * @param seconds The charging time in seconds
+	 * @return The SoC in kWh (not capped at the battery capacity).
+	 */
+	double socAfter(double fromSoc, double seconds) const {
+		double target = secondsUntil(fromSoc) + seconds;
+		auto next = upper_bound(segments.begin(), segments.end(), target, [](double t, const Segment& seg) { return t < seg.secondsFromZero; });
+		const Segment& seg = next == segments.begin() ? segments.front() : *(next - 1);
+		if (seg.socInKwh <= fromSoc) // Charging starts within this segment
+			return socWithin(seg, secondsWithin(seg, fromSoc) + seconds);
+		return socWithin(seg, target - seg.secondsFromZero);
+	}
+
+	/**
+	 * @brief Calculates the SoC after a charging stop of a given time.
+	 *
+	 * @param soc The SoC at arrival
+	 * @param chargingTimeInSeconds The time of the stop in seconds, charging only starts after offsetInSec
+	 * @param offsetInSec The time at the stop before charging starts
+	 * @param maxChargeInKwh The capacity of the battery
+	 * @return SoC after the stop, capped at maxChargeInKwh.
+	 */
+	float chargeAfterStop(float soc, int chargingTimeInSeconds, int offsetInSec, float maxChargeInKwh) const {
+		if (chargingTimeInSeconds > offsetInSec)
+			chargingTimeInSeconds -= offsetInSec;
+		else
+			return soc;
+		if (soc >= maxChargeInKwh)
+			return soc;
+		return min(maxChargeInKwh, static_cast<float>(socAfter(soc, chargingTimeInSeconds)));
+	}
+
+	/**
+	 * @brief Calculates the time of a charging stop that charges to a specific value.
+	 *
+	 * @param soc The SoC at arrival
+	 * @param goalSoc The SoC to charge to, capped at maxChargeInKwh
+	 * @param offsetInSec The time at the stop before charging starts
+	 * @param maxChargeInKwh The capacity of the battery
+	 * @return Time in seconds including the offset, -1 if goalSoc cannot be reached.
+	 */
+	int stopTimeNeeded(float soc, float goalSoc, int offsetInSec, float maxChargeInKwh) const {
+		goalSoc = min(goalSoc, maxChargeInKwh);
+		if (soc > goalSoc) return 0;
+		double seconds = secondsBetween(soc, goalSoc);
+		if (!isfinite(seconds))
+			return -1;
+		return offsetInSec + static_cast<int>(ceil(seconds));
+	}
+};
@@ -0,0 +1,134 @@
+/**
+ * @file CompiledVehicleProfile.h
+ * @brief Defines an immutable, precompiled form of an EvCar for the routing.
+ * The consumption curve is sampled into a uniform lookup table, the altitude factors are computed once and the
+ * charging curve is integrated for the given connector powers. Compile each vehicle model once and share the profile
+ * between all routings of that model.
+ */
+#pragma once
+
+#include "ChargingConnector.h"
+#include "ChargingTimeTable.h"
+#include "EvCar.h"
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define CONSUMPTION_LUT_MAX_KMH 250 // The consumption table has one entry per km/h up to this speed.
+
+struct CompiledVehicleProfile {
+	string car_model;
+	float maxChargeInKwh;
+	float minChargeAtDestinationInkWh;
+	float minChargeAtChargingStopsInkWh;
+	int chargingTimeOffsetInSec;
+	int maxChargingTimeInSec;
+	bool hasChargingCurve;
+	float altitudeGainFactor; // kWh per km of altitude gain
+	float altitudeLossFactor; // kWh recuperated per km of altitude loss
+	vector<float> consumptionPerKm; // kWh per km at 0, 1, ..., CONSUMPTION_LUT_MAX_KMH km/h
+	float fastestSpeed, fastestConsumption, fastestSlope; // Extrapolation of the last curve segment beyond the table
+	vector<pair<float, float>> chargingCurve;
+	map<float, ChargingTimeTable> chargingTables; // One integrated charging curve per connector power
+
+	/**
+	 * @brief Compiles the profile of a vehicle.
+	 *
+	 * @param car The vehicle
+	 * @param connectorPowers The rated powers of the connectors the vehicle will charge at. Charging at other connectors works as well, but is slower.
+	 */
+	CompiledVehicleProfile(const EvCar& car, const vector<float>& connectorPowers = {})
+		: car_model{car.car_model}, maxChargeInKwh{car.maxChargeInKwh}, minChargeAtDestinationInkWh{car.minChargeAtDestinationInkWh},
+		minChargeAtChargingStopsInkWh{car.minChargeAtChargingStopsInkWh}, chargingTimeOffsetInSec{car.chargingTimeOffsetInSec},
+		maxChargingTimeInSec{car.maxChargingTimeInSec}, hasChargingCurve{car.hasChargingCurve}, chargingCurve{car.chargingCurve} {
+		altitudeGainFactor = car.vehicleConsumptionInKwhAltitudeGain();
+		altitudeLossFactor = car.vehicleRecuperationInKwhAltitudeLoss();
+		consumptionPerKm.resize(CONSUMPTION_LUT_MAX_KMH + 1);
+		for (int kmh = 0; kmh <= CONSUMPTION_LUT_MAX_KMH; ++kmh)
+			consumptionPerKm[kmh] = car.consumptionPerKmAtVelocity(kmh);
+		fastestSpeed = CONSUMPTION_LUT_MAX_KMH;
+		fastestConsumption = consumptionPerKm.back();
+		fastestSlope = consumptionPerKm.back() - consumptionPerKm[CONSUMPTION_LUT_MAX_KMH - 1];
+		if (hasChargingCurve) {
+			for (float power : connectorPowers)
+				if (chargingTables.find(power) == chargingTables.end())
+					chargingTables.emplace(power, ChargingTimeTable(chargingCurve, power));
+		}
+	}
+
+	float consumptionPerKmAtVelocity(float velocity) const {
+		if (velocity >= fastestSpeed)
+			return fastestConsumption + (velocity - fastestSpeed) * fastestSlope;
+		if (velocity <= 0)
+			return consumptionPerKm[0];
+		size_t i = static_cast<size_t>(velocity);
+		float proportion = velocity - i;
+		return consumptionPerKm[i] + proportion * (consumptionPerKm[i + 1] - consumptionPerKm[i]);
+	}
+
+	/**
+	 * @brief Calcualtes the consumption of the EV for a given edge.
+	 *
+	 * @return the consumption for this edge in kWh, can be negative.
+	 */
+	float energyCost(float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) const {
+		float velocity = (lengthInMeters / timeInSeconds) * 3.6;
+		float consumption = consumptionPerKmAtVelocity(velocity) * (lengthInMeters / 1000);
+		if (altitudeGainInKm > 0)
+			consumption += altitudeGainInKm * altitudeGainFactor;
+		else
+			consumption -= altitudeGainInKm * altitudeLossFactor;
+		return consumption;
+	}
+
+	/**
+	 * @brief Returns the remaining soc after the edge is driven (at speed limit velocity)
+	 *
+	 * @return Remaining state of charge after edge, might be negative.
+	 */
+	float socAfterEdge(float soc, float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) const {
+		return min(maxChargeInKwh, soc - energyCost(timeInSeconds, lengthInMeters, altitudeGainInKm));
+	}
+
+	/**
+	 * @brief Returns the integrated charging curve for a connector power.
+	 *
+	 * @param maxPowerInKw The rated power of the connector
+	 * @param buffer Receives the table if it has not been compiled for this power
+	 * @return The compiled table or buffer.
+	 */
+	const ChargingTimeTable& getChargingTable(float maxPowerInKw, ChargingTimeTable& buffer) const {
+		auto table = chargingTables.find(maxPowerInKw);
+		if (table != chargingTables.end())
+			return table->second;
+		buffer = ChargingTimeTable(chargingCurve, maxPowerInKw);
+		return buffer;
+	}
+
+	/**
+	 * @brief Calculates the SoC after charging a given time at a connector.
+	 *
+	 * @return SoC after the given time, capped at the maxChargeInKw.
+	 */
+	float chargeAfterTime(const ChargingConnector& conn, float soc, int chargingTimeInSeconds) const {
+		if (!hasChargingCurve)
+			return -1.0;
+		ChargingTimeTable buffer;
+		return getChargingTable(conn.ratedPowerKw, buffer).chargeAfterStop(soc, chargingTimeInSeconds, chargingTimeOffsetInSec, maxChargeInKwh);
+	}
+
+	/**
+	 * Calculate the time (in seconds) to charge at a given connector to a specific value.
+	 *
+	 * @return Time in seconds to reach the demanded charge, -1 if it cannot be reached.
+	 */
+	int time_needed(const ChargingConnector& conn, float soc, float goal_soc) const {
+		if (!hasChargingCurve)
+			return -1;
+		ChargingTimeTable buffer;
+		return getChargingTable(conn.ratedPowerKw, buffer).stopTimeNeeded(soc, goal_soc, chargingTimeOffsetInSec, maxChargeInKwh);
+	}
+};
@@ -0,0 +1,71 @@
+/**
+ * @file DistanceKernel.h
+ * @brief Filters coordinate arrays by a flat distance before the exact distance is computed.
+ * The haversine formula of distance_in_km() needs several trigonometric functions in long double, while most parks
+ * of a scanned cell are far away. The filter compares a squared equirectangular distance in degrees against a bound,
+ * which is a handful of multiplications per park, and only the parks that pass it get the exact distance.
+ * Built with ROUTING_AVX2 (see CMakeLists.txt), four parks are filtered per instruction. The vector and the scalar
+ * version compute the same products and sums without fused multiply-adds, so both keep exactly the same parks.
+ */
+#pragma once
+
+#include "Point.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#define KM_PER_DEG (6371 * M_PI / 180) // Length of one degree of latitude in km.
+#define FLAT_DISTANCE_SLACK 0.99 // The flat distance may exceed the exact one by up to 1 %, so the bound is widened by that.
+#define FLAT_DISTANCE_MAX_KM 500 // Further the flat distance is not accurate enough, so nothing is filtered.
+
+/**
+ * @brief Returns the bound of filterByFlatDistance() for a distance in km.
+ *
+ * @param distanceInKm Parks within this distance must pass the filter
+ * @return The squared distance in degrees, infinity for distances beyond FLAT_DISTANCE_MAX_KM.
+ */
+inline double flatDistanceBound(double distanceInKm) {
+	if (distanceInKm > FLAT_DISTANCE_MAX_KM)
+		return numeric_limits<double>::infinity();
+	return pow(distanceInKm / (FLAT_DISTANCE_SLACK * KM_PER_DEG), 2);
+}
+
+/**
+ * @brief Appends the positions in [first, last) whose flat distance to a point is within a bound.
+ *
+ * @param lat The latitudes of the parks
+ * @param lon The longitudes of the parks
+ * @param first The first position to check
+ * @param last The position after the last one to check
+ * @param pointLat The latitude of the point
+ * @param pointLon The longitude of the point
+ * @param lonScale The length of a degree of longitude relative to one of latitude, e.g. the cosine of the latitude
+ * @param maxSquaredDeg The bound, see flatDistanceBound()
+ * @param survivors The positions that pass are appended in ascending order
+ */
+inline void filterByFlatDistance(const double* lat, const double* lon, unsigned first, unsigned last, double pointLat, double pointLon, double lonScale, double maxSquaredDeg, vector<unsigned>& survivors) {
+	unsigned i = first;
+#if defined(__AVX2__)
+	const __m256d centerLat = _mm256_set1_pd(pointLat), centerLon = _mm256_set1_pd(pointLon);
+	const __m256d scale = _mm256_set1_pd(lonScale), bound = _mm256_set1_pd(maxSquaredDeg);
+	for (; i + 4 <= last; i += 4) {
+		__m256d dLat = _mm256_sub_pd(_mm256_loadu_pd(lat + i), centerLat);
+		__m256d dLon = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(lon + i), centerLon), scale);
+		__m256d squared = _mm256_add_pd(_mm256_mul_pd(dLat, dLat), _mm256_mul_pd(dLon, dLon));
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(squared, bound, _CMP_NGT_UQ)); // Not greater, like the scalar loop
+		for (unsigned lane = 0; mask != 0; ++lane, mask >>= 1)
+			if (mask & 1)
+				survivors.push_back(i + lane);
+	}
+#endif
+	for (; i < last; ++i) {
+		double dLat = lat[i] - pointLat, dLon = (lon[i] - pointLon) * lonScale;
+		if (!(dLat * dLat + dLon * dLon > maxSquaredDeg))
+			survivors.push_back(i);
+	}
+}
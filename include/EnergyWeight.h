@@ -0,0 +1,35 @@
+/**
+ * @file EnergyWeight.h
+ * @brief Describes the energy a vehicle needs to drive along an arc as an extra weight for RoutingKit's CH queries.
+ * This lets a query return the consumption to its targets without unpacking the paths.
+ */
+#pragma once
+
+#include "CompiledVehicleProfile.h"
+#include "Graph.h"
+
+/**
+ * @brief Link function that concatenates the energy of two consecutive paths.
+ */
+struct AddEnergy {
+	float operator()(float first, float second) const {
+		return first + second;
+	}
+};
+
+/**
+ * @brief The energy a vehicle needs for every arc of a graph, precomputed once per vehicle and graph.
+ * The weights are also propagated to the shortcuts of the contraction hierarchy, so a CH query returns the
+ * consumption to its targets directly. Build a new EnergyWeight if the parameters of the vehicle change.
+ */
+struct EnergyWeight {
+	vector<float> arcEnergy; // kWh needed for each arc of the graph
+	ContractionHierarchyExtraWeight<float> chWeight; // kWh needed for each arc and shortcut of the CH
+
+	EnergyWeight(const Graph& g, const CompiledVehicleProfile& profile) {
+		arcEnergy.resize(g.arc_count());
+		for (unsigned arc = 0; arc < g.arc_count(); ++arc)
+			arcEnergy[arc] = profile.energyCost(g.travelTimeInSec(arc), g.distanceInMeter(arc));
+		chWeight.reset(g.ch, arcEnergy, AddEnergy());
+	}
+};
@@ -5,8 +5,12 @@
 #pragma once
 
 #include "ChargingConnector.h"
+#include "ChargingTimeTable.h"
 #include "StringUtil.h"
 #include "json.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
 using json = nlohmann::json;
 
 using namespace std;
@@ -24,6 +28,11 @@ struct EvCar {
 	float weight = 0.0;
 	std::vector<pair<int, float>> consumptionList = {};
 	std::vector<pair<float, float>> chargingCurve = {};
+	struct ChargingTableCache {
+		mutex lock;
+		map<float, ChargingTimeTable> tables; // One table per connector power, entries are never removed
+	};
+	shared_ptr<ChargingTableCache> chargingTables = make_shared<ChargingTableCache>(); // Shared by copies of the car, which may be used by several threads.
 
 	/**
 	 * @brief Construct a new Ev Car object
@@ -51,9 +60,25 @@ struct EvCar {
             std::pair<float, float> firstPair = make_pair(0.0, chargingCurve[0].second);
             chargingCurve.insert(chargingCurve.begin(), firstPair);
         }
+		chargingTables = make_shared<ChargingTableCache>();
 	}
 
-	size_t getConsumptionCurveIndex(float kmh) {
+	/**
+	 * @brief Get the integrated charging curve for a connector, it is built on first use.
+	 * The routing uses the tables of CompiledVehicleProfile, which are built in advance, so this lock is not contended.
+	 * 
+	 * @param maxPowerInKw The rated power of the connector
+	 * @return The table with the cumulative charging times at this connector.
+	 */
+	const ChargingTimeTable& getChargingTable(float maxPowerInKw) const {
+		lock_guard<mutex> guard(chargingTables->lock);
+		auto table = chargingTables->tables.find(maxPowerInKw);
+		if (table == chargingTables->tables.end())
+			table = chargingTables->tables.emplace(maxPowerInKw, ChargingTimeTable(chargingCurve, maxPowerInKw)).first;
+		return table->second; // Stays valid, a map does not move its entries
+	}
+
+	size_t getConsumptionCurveIndex(float kmh) const {
 		size_t i = 0;
 		for (; i < consumptionList.size() - 1; ++i) {
 			if (consumptionList[i + 1].first >= kmh) return i;
@@ -67,7 +92,7 @@ struct EvCar {
 	 * @param edge The edge to drive along (with allowed max speed)
 	 * @return the consumption for this edge in kWh, can be negative.
 	 */
-	float energyCost(float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) {
+	float energyCost(float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) const {
 		float velocity = speedInKmH(timeInSeconds, lengthInMeters);
 		float lengthInKm = lengthInMeters/1000;
 		float consumption = consumptionPerKmAtVelocity(velocity) * lengthInKm;
@@ -79,11 +104,11 @@ struct EvCar {
 		return consumption;
 	}
 
-	float speedInKmH(float timeInSeconds, float lengthInMeters) {
+	float speedInKmH(float timeInSeconds, float lengthInMeters) const {
 		return (lengthInMeters / timeInSeconds) * 3.6;
 	}
 
-	float consumptionPerKmAtVelocity(float velocity) {
+	float consumptionPerKmAtVelocity(float velocity) const {
 		size_t i = getConsumptionCurveIndex(velocity);
 		auto [x, fx] = consumptionList[i]; auto [z, fz] = consumptionList[i + 1];
 		float proportion = (velocity - x) / (z - x);
@@ -96,7 +121,7 @@ struct EvCar {
 	 * 
 	 * @return A factor that should be multiplied with the km of altitude change if road is uphill.
 	 */
-	float vehicleConsumptionInKwhAltitudeGain() {
+	float vehicleConsumptionInKwhAltitudeGain() const {
 		if (weight <= 0.0)
 			return 0.0;
 		return (weight * 9.81 * 1000.0 / 3600000.0) / 0.85;
@@ -107,13 +132,13 @@ struct EvCar {
 	 * 
 	 * @return A factor that should be multiplied with the km of altitude change if road is downhill.
 	 */
-	float vehicleRecuperationInKwhAltitudeLoss() {
+	float vehicleRecuperationInKwhAltitudeLoss() const {
 		if (weight <= 0.0)
 			return 0.0;
 		return (weight * 9.81 * 1000.0 / 3600000.0) * 0.9;
 	}
 
-	size_t getChargingCurveIndex(float soc) {
+	size_t getChargingCurveIndex(float soc) const {
 		for (size_t i = 0; i < chargingCurve.size() - 1; ++i)
 			if (chargingCurve[i + 1].first > soc) return i;
 		return chargingCurve.size() - 1;
@@ -125,7 +150,7 @@ struct EvCar {
 	 * @param soc The current state of charge of the vehicle
 	 * @return float kW that the vehicle can charge with 
 	 */
-	float getChargingSpeed(float soc) {
+	float getChargingSpeed(float soc) const {
 		size_t index = getChargingCurveIndex(soc);
 		if (index == chargingCurve.size() - 1)
 			return chargingCurve[index].second;
@@ -144,22 +169,10 @@ struct EvCar {
 	 * @param chargingTimeInSeconds The charging time in seconds. This should be greater than the chargingOffsetInSec.
 	 * @return SoC after the given time, capped at the maxChargeInKw.
 	 */
-	float chargeAfterTime(const ChargingConnector& conn, float soc, int chargingTimeInSeconds) {
+	float chargeAfterTime(const ChargingConnector& conn, float soc, int chargingTimeInSeconds) const {
 		if (!hasChargingCurve)
 			return -1.0;
-		if (chargingTimeInSeconds > chargingTimeOffsetInSec)
-			chargingTimeInSeconds -= chargingTimeOffsetInSec;
-		else
-			return soc;
-		float vehicleChargingSpeed = getChargingSpeed(soc);
-		while (chargingTimeInSeconds > 0 && soc < maxChargeInKwh) {
-			int timeInSeconds = min(chargingTimeInSeconds, 30); // this means: update charging speed after 30s
-			float speed = min(conn.ratedPowerKw, vehicleChargingSpeed);
-			soc += (static_cast<float>(timeInSeconds) / 3600) * speed;
-			chargingTimeInSeconds -= timeInSeconds;
-			vehicleChargingSpeed = getChargingSpeed(soc);
-		}
-		return soc;
+		return getChargingTable(conn.ratedPowerKw).chargeAfterStop(soc, chargingTimeInSeconds, chargingTimeOffsetInSec, maxChargeInKwh);
 	}
 
 	/**
@@ -168,25 +181,12 @@ struct EvCar {
 	 * @param conn The ChargingConnector to charge at.
 	 * @param soc The state of charge to start charging
 	 * @param goal_soc The state of charge to charge to.
-	 * @return Time in seconds to reach the demanded charge.
+	 * @return Time in seconds to reach the demanded charge, -1 if it cannot be reached.
 	 */
-	int time_needed(const ChargingConnector& conn, float soc, float goal_soc) {
+	int time_needed(const ChargingConnector& conn, float soc, float goal_soc) const {
 		if (!hasChargingCurve)
 			return -1;
-		goal_soc = min(goal_soc, maxChargeInKwh);
-		if (soc > goal_soc) return 0;
-		int chargingTimeInSeconds = chargingTimeOffsetInSec;
-		float vehicleChargingSpeed = getChargingSpeed(soc);
-		while (soc < goal_soc) {
-			int timeInSeconds = 30; // this means: update charging speed after 30s
-			float speed = min(conn.ratedPowerKw, vehicleChargingSpeed);
-			if (speed <= 0)
-				return -1;
-			soc += (static_cast<float>(timeInSeconds) / 3600) * speed;
-			chargingTimeInSeconds += timeInSeconds;
-			vehicleChargingSpeed = getChargingSpeed(soc);
-		}
-		return chargingTimeInSeconds;
+		return getChargingTable(conn.ratedPowerKw).stopTimeNeeded(soc, goal_soc, chargingTimeOffsetInSec, maxChargeInKwh);
 	}
 
 	/**
@@ -196,7 +196,7 @@ struct EvCar {
 	 * @param e The edge to drive
 	 * @return Remaining state of charge after edge, might be negative. 
 	 */
-	float socAfterEdge(float soc, float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) {
+	float socAfterEdge(float soc, float timeInSeconds, float lengthInMeters, float altitudeGainInKm = 0.0) const {
 		return min(maxChargeInKwh, soc - energyCost(timeInSeconds, lengthInMeters, altitudeGainInKm));
 	}
 };
@@ -6,115 +6,147 @@
 
 #include "RoutingResult.h"
 #include "ChargeEvent.h"
-#include "ChargingPark.h"
+#include "ChargerStore.h"
 #include "Graph.h"
 #include "Point.h"
-#include <set>
-#include "EvCar.h"
+#include "CompiledVehicleProfile.h"
+#include "EnergyWeight.h"
+#include "QueryContext.h"
+#include "RouteCounters.h"
+#include "RouteState.h"
+#include "TraceRecorder.h"
+#include "WorkStealingPool.h"
 using namespace std;
 
 #define BACKTRACE_START_PCT 0.25
 #define BACKTRACE_END_KW 200
+#define BACKTRACE_BUFFER_KM 10 // Charging parks further away from the route are not considered.
+#define PARALLEL_RATING_MIN_PARKS 2 // Fewer candidates are rated on the calling thread only.
+#define PARALLEL_RATING_CHUNK 16 // Candidates per search when the rating is spread over a pool.
 
+/**
+ * The routing does not change while it calculates a route: the vehicle profile and the graph are shared and read-only,
+ * and everything that belongs to one route is kept in a RouteState. Only the QueryContext is scratch memory, so one
+ * EvRouting must not be used by several threads at the same time. Its searches can still be spread over a pool.
+ */
 class EvRouting {
 private:
-	EvCar& car;
-	Graph g;
+	GraphSnapshot g;
+	shared_ptr<const CompiledVehicleProfile> profile;
+	shared_ptr<const EnergyWeight> energy;
+	QueryContext* ctx;
+	unique_ptr<QueryContext> ownContext;
+	WorkStealingPool* pool;
 public:
-	EvRouting(EvCar& _car, Graph _graph) : car{_car}, g{_graph} {
+	/**
+	 * @brief Construct a new routing algorithm for a vehicle.
+	 * 
+	 * @param _graph The graph to route on
+	 * @param _profile The compiled vehicle, it can be shared between several routings of the same vehicle model.
+	 * @param _energy The consumption of the vehicle on this graph. Pass it in to share it between several routings of the same vehicle, otherwise it is computed here.
+	 * @param _context The scratch memory of the calling thread. If none is given, the routing allocates its own.
+	 * @param _pool Rates the candidate charging parks in parallel, it can be shared by several routings. Without a pool everything runs on the calling thread.
+	 */
+	EvRouting(GraphSnapshot _graph, shared_ptr<const CompiledVehicleProfile> _profile, shared_ptr<const EnergyWeight> _energy = nullptr, QueryContext* _context = nullptr, WorkStealingPool* _pool = nullptr)
+		: g{_graph}, profile{_profile}, energy{_energy}, ctx{_context}, pool{_pool} {
+		if (energy == nullptr)
+			energy = make_shared<EnergyWeight>(*g, *profile);
+		if (ctx == nullptr) {
+			ownContext = make_unique<QueryContext>();
+			ctx = ownContext.get();
+		}
+		ctx->attach(*g);
 	}
 
 	/**
-	 * @brief Returns the combined time of driving from the start to this park and from this park to the target.
+	 * @brief Returns the combined time of driving from the start to each park and from the park to the target, with
+	 * only two CH searches: one from the source to all parks and one from all parks to the target.
 	 * 
-	 * @param park The charging park
+	 * @param state The route that is calculated
+	 * @param parks The charging parks to rate
 	 * @param source The start of the route
 	 * @param target The destination of the route
-	 * @return float the required travel time via the charging park (without charging time). Retunrs inf, if the park is not reachable with the given minChargeAtChargingStops of the vehicle. 
+	 * @return vector<float> the score of each park in the order of parks, the maximum float if the park cannot be reached
+	 * with minChargeAtChargingStopsInkWh left. It is only valid until the next call.
+	 * The searches are spread over the pool if the routing has one.
 	 */
-	float rateChargingPark(ChargingPark* park, unsigned long source, unsigned long target) {
-		auto firstPart = calculateDistances(source, park->node);
-		if (firstPart.first < car.minChargeAtChargingStopsInkWh) // We don't need to consider this park even further!
-			return std::numeric_limits<float>::max();
-		return firstPart.second + calculateDistances(park->node, target).second;
+	const vector<float>& rateChargingParks(const RouteState& state, const vector<unsigned>& parks, unsigned long source, unsigned long target) const {
+		TraceSpan span("rateChargingParks", "parks", parks.size());
+		ctx->parkNodes.clear();
+		for (unsigned park : parks)
+			ctx->parkNodes.push_back(g->chargers.node[park]);
+		ctx->timeToPark.resize(parks.size());
+		ctx->energyToPark.resize(parks.size());
+		ctx->timeFromPark.resize(parks.size());
+		countRouteEvent(COUNTER_CANDIDATES_RATED, parks.size());
+		if (pool == nullptr || parks.size() < PARALLEL_RATING_MIN_PARKS) {
+			countRouteEvent(COUNTER_CH_QUERIES, 2);
+			searchToParks(*ctx, 0, parks.size(), source);
+			searchFromParks(*ctx, 0, parks.size(), target);
+		} else {
+			// Both directions of every chunk are independent searches. Each one writes its own part of the results,
+			// and the chunks do not depend on the number of workers, so the scores are the same for every pool size.
+			size_t chunks = (parks.size() + PARALLEL_RATING_CHUNK - 1) / PARALLEL_RATING_CHUNK;
+			countRouteEvent(COUNTER_CH_QUERIES, 2 * chunks); // Counted here, the workers count into their own slots.
+			pool->run(2 * chunks, [&](size_t task, size_t worker) {
+				QueryContext* workspace = ctx; // The calling thread searches with its own context.
+				if (worker < pool->size()) {
+					static thread_local QueryContext workerContext;
+					workerContext.attach(*g);
+					workspace = &workerContext;
+				}
+				size_t first = (task / 2) * PARALLEL_RATING_CHUNK;
+				size_t count = min<size_t>(PARALLEL_RATING_CHUNK, parks.size() - first);
+				if (task % 2 == 0)
+					searchToParks(*workspace, first, count, source);
+				else
+					searchFromParks(*workspace, first, count, target);
+			});
+		}
+		ctx->scores.assign(parks.size(), std::numeric_limits<float>::max());
+		for (size_t p = 0; p < parks.size(); ++p) {
+			if (ctx->timeToPark[p] == inf_weight || ctx->timeFromPark[p] == inf_weight)
+				continue;
+			if (state.currentChargeInKwh - ctx->energyToPark[p] < profile->minChargeAtChargingStopsInkWh) // We don't need to consider this park even further!
+				continue;
+			ctx->scores[p] = ctx->timeToPark[p] / 1000.0 + ctx->timeFromPark[p] / 1000.0;
+		}
+		return ctx->scores;
 	}
 
 	/**
-	 * For a node, check the surrounding charging parks and return the best one for the given position.
-	 * @param location The node to search the charging parks around
-	 * @param source_id The start of the trip (osm_id)
-	 * @param target_it The destination of the trip (osm_id)
-	 * @param currentBestKw The charging power of the currently best charger
-	 * @return Pair of ChargingPark* and score of charging park.
+	 * @brief One-to-many search from the source to the parks ctx->parkNodes[first, first + count).
+	 * Writes the travel times and the consumption to ctx->timeToPark and ctx->energyToPark.
+	 * 
+	 * @param workspace The query memory of the calling thread
 	 */
-	pair<ChargingPark*, double> getBestChargingPark(Point* location, unsigned long source_id, unsigned long target_id, set<ChargingPark*>* blacklist, float currentBestKw = 0.0) {
-		// Get 10 nearest chargers and filter out all that are too far away (10 km)
-		vector<ChargingPark*> stations = g.findKNearestChargers(location, 10, 10);
-		vector<ChargingPark*> bestStations = {};
-		float bestChargingPower = currentBestKw;
-		for (ChargingPark* park : stations) {
-			if (blacklist->find(park) != blacklist->end()) // if Charger is already on the blacklist -> Skip it
-				continue;
-			float ratedPower = park->getBestConnFor(car)->ratedPowerKw;
-			if (ratedPower < bestChargingPower) {
-				blacklist->insert(park);
-				continue;
-			}
-			if (bestStations.empty()) {
-				bestStations.push_back(park);
-				bestChargingPower = ratedPower;
-				continue;
-			}
-			if (ratedPower > bestChargingPower) {
-				for (auto station : bestStations) // All parks in the current list can be skipped in the future.
-					blacklist->insert(station);
-				bestStations.clear();
-				bestStations.push_back(park);
-				bestChargingPower = ratedPower;
-			} else if (ratedPower == bestChargingPower) {
-				bestStations.push_back(park);
-			}
-		}
-		if (bestStations.size() == 0)
-			return make_pair(nullptr, std::numeric_limits<float>::max());
-		ChargingPark* best = bestStations[0];
-		double best_score = rateChargingPark(best, source_id, target_id);
-		if (bestStations.size() == 1)
-			return make_pair(best, best_score);
-		// Rate all charging stations and select the station with the lowest score.
-		for (auto station : bestStations) {
-			double score = rateChargingPark(station, source_id, target_id);
-			if (score < best_score) {
-				best_score = score;
-				best = station;
-			}
-		}
-		blacklist->insert(best); // We can add the best to the blacklist so we don't find it in the future.
-		return make_pair(best, best_score);
+	void searchToParks(QueryContext& workspace, size_t first, size_t count, unsigned long source) const {
+		TraceSpan span("chQueryToParks", "parks", count);
+		vector<unsigned>& nodes = workspace.chunkNodes;
+		nodes.assign(ctx->parkNodes.begin() + first, ctx->parkNodes.begin() + first + count);
+		ContractionHierarchyQuery& ch_query = workspace.chQuery;
+		ch_query.reset().pin_targets(nodes);
+		ch_query.reset_source().add_source(source).run_to_pinned_targets();
+		ch_query.get_distances_to_targets(ctx->timeToPark.data() + first);
+		workspace.chunkEnergy.resize(count);
+		ch_query.get_extra_weight_distances_to_targets(energy->chWeight, AddEnergy(), workspace.energyTmp, workspace.chunkEnergy);
+		copy(workspace.chunkEnergy.begin(), workspace.chunkEnergy.begin() + count, ctx->energyToPark.begin() + first);
 	}
 
 	/**
-	 * @brief Returns the remaining charge at the destination and distance in km. SoC can be negative.
+	 * @brief Many-to-one search from the parks ctx->parkNodes[first, first + count) to the target.
+	 * Writes the travel times to ctx->timeFromPark.
 	 * 
-	 * @param from the id of the source node 
-	 * @param to the id of the target node
-	 * @return pair<float, float> result.first is the remaining SoC, result.second is the time in seconds. 
+	 * @param workspace The query memory of the calling thread
 	 */
-	pair<float, float> calculateDistances(unsigned long from, unsigned long to) {
-		ContractionHierarchyQuery ch_query(g.ch);
-		ch_query.reset().add_source(from).add_target(to).run();
-		vector<unsigned> edges = ch_query.get_arc_path();
-		vector<float> soc = { car.currentChargeInKwh };
-		double distanceInMeters = 0.0;
-		double timeInSeconds = 0.0;
-		for (auto edge : edges) {
-			float distance = g.distanceInMeter(edge);
-			float time = g.travelTimeInSec(edge);
-            timeInSeconds += time;
-            distanceInMeters += distance;
-			soc.push_back(car.socAfterEdge(soc[soc.size() - 1], time, distance));
-        }
-		return make_pair(soc[soc.size() - 1], timeInSeconds);
+	void searchFromParks(QueryContext& workspace, size_t first, size_t count, unsigned long target) const {
+		TraceSpan span("chQueryFromParks", "parks", count);
+		vector<unsigned>& nodes = workspace.chunkNodes;
+		nodes.assign(ctx->parkNodes.begin() + first, ctx->parkNodes.begin() + first + count);
+		ContractionHierarchyQuery& ch_query = workspace.chQuery;
+		ch_query.reset().pin_sources(nodes);
+		ch_query.reset_target().add_target(target).run_to_pinned_sources();
+		ch_query.get_distances_to_sources(ctx->timeFromPark.data() + first);
 	}
 
 	/**
@@ -122,92 +154,300 @@ public:
 	 *
 	 * @param source_id: The id of the source node.
 	 * @param target_id: The id of the target node.
+	 * @param initialChargeInKwh: The state of charge at the source.
 	 * @return The route to drive.
 	 */
-	Route* calculateRoute(unsigned long source_id, unsigned long target_id) {
+	Route* calculateRoute(unsigned long source_id, unsigned long target_id, float initialChargeInKwh) const {
+		return calculateRoute(source_id, target_id, initialChargeInKwh, nullptr, nullptr);
+	}
+
+	/**
+	 * Calculate a route for an electric vehicle between two positions on arcs, see SnappingService::snapToArc().
+	 * The route can leave the arc of the source and enter the arc of the target in both directions of the road. The
+	 * parts of the arcs that are driven count towards the time, the length and the consumption of the first and the
+	 * last leg, and the legs start and end at the projected positions.
+	 *
+	 * @param source: The position of the source.
+	 * @param target: The position of the target.
+	 * @param initialChargeInKwh: The state of charge at the source.
+	 * @return The route to drive.
+	 */
+	Route* calculateRoute(const ArcSnapResult& source, const ArcSnapResult& target, float initialChargeInKwh) const {
+		return calculateRoute(0, 0, initialChargeInKwh, &source, &target);
+	}
+
+private:
+	/**
+	 * @brief Returns the SoC after driving a share of an arc, the start and the end of a route can lie within an arc.
+	 */
+	float socAfterArc(float soc, unsigned arc, float share = 1.0) const {
+		if (share <= 0.0)
+			return min(profile->maxChargeInKwh, soc);
+		return profile->socAfterEdge(soc, g->travelTimeInSec(arc) * share, g->distanceInMeter(arc) * share);
+	}
+
+	/**
+	 * @brief Appends the arcs of the fastest path between two nodes.
+	 *
+	 * @param evRoute The route that is calculated, the query is timed in its stages
+	 * @param from The start node
+	 * @param to The end node
+	 * @param edges The path is appended to it
+	 * @return false if there is no path between the nodes, then nothing is appended.
+	 */
+	bool appendArcPath(Route* evRoute, unsigned long from, unsigned long to, vector<unsigned>& edges) const {
+		StageTimer timer(evRoute->stageTimes, STAGE_CH_QUERY);
+		TraceSpan span("chQuery", "arcs", 0);
+		ContractionHierarchyQuery& ch_query = ctx->chQuery;
+		ch_query.reset().add_source(from).add_target(to).run();
+		countRouteEvent(COUNTER_CH_QUERIES);
+		if (ch_query.get_distance() == inf_weight)
+			return false;
+		vector<unsigned> path = ch_query.get_arc_path();
+		countRouteEvent(COUNTER_ARCS_UNPACKED, path.size());
+		span.setArg("arcs", path.size());
+		edges.insert(edges.end(), path.begin(), path.end());
+		return true;
+	}
+
+	/**
+	 * @brief Decides in which direction the route leaves the arc of the source and enters the arc of the target.
+	 * Both directions of both arcs go into one CH query, with the time of their partial arc as the distance to the
+	 * source or the target, so the query picks the fastest combination and already finds the path of the first leg.
+	 * A target further ahead on the arc of the source is reached without leaving the arc.
+	 *
+	 * @param state The route that is calculated, its first and last arc are set
+	 * @param source The position of the source
+	 * @param target The position of the target
+	 * @param source_id Set to the first node of the route
+	 * @param target_id Set to the last node of the route
+	 * @param path Set to the arcs between the two nodes
+	 * @return false if the target cannot be reached, then the path is empty.
+	 */
+	bool chooseArcDirections(RouteState& state, const ArcSnapResult& source, const ArcSnapResult& target, unsigned long& source_id, unsigned long& target_id, vector<unsigned>& path) const {
+		PartialArc leave[2] = {{source.arc, source.fraction, 1.0f}, {source.reverseArc, 1.0f - source.fraction, 1.0f}};
+		PartialArc enter[2] = {{target.arc, 0.0f, target.fraction}, {target.reverseArc, 0.0f, 1.0f - target.fraction}};
+		auto timeOf = [&](const PartialArc& part) {
+			return static_cast<unsigned>(lround((part.to - part.from) * g->travel_time[part.arc]));
+		};
+		StageTimer timer(state.route->stageTimes, STAGE_CH_QUERY);
+		TraceSpan span("chQuery", "arcs", 0);
+		ContractionHierarchyQuery& ch_query = ctx->chQuery;
+		ch_query.reset();
+		for (const PartialArc& part : leave)
+			if (part.valid())
+				ch_query.add_source(g->head[part.arc], timeOf(part));
+		for (const PartialArc& part : enter)
+			if (part.valid())
+				ch_query.add_target(g->tail[part.arc], timeOf(part));
+		ch_query.run();
+		countRouteEvent(COUNTER_CH_QUERIES);
+		unsigned bestTime = ch_query.get_distance();
+		if (bestTime != inf_weight) {
+			source_id = ch_query.get_used_source();
+			target_id = ch_query.get_used_target();
+			path = ch_query.get_arc_path();
+			countRouteEvent(COUNTER_ARCS_UNPACKED, path.size());
+			span.setArg("arcs", path.size());
+			for (const PartialArc& part : leave)
+				if (part.valid() && g->head[part.arc] == source_id)
+					state.firstArc = part;
+			for (const PartialArc& part : enter)
+				if (part.valid() && g->tail[part.arc] == target_id)
+					state.lastArc = part;
+		}
+		for (const PartialArc& part : leave) {
+			for (const PartialArc& other : enter) {
+				PartialArc direct = {part.arc, part.from, other.to};
+				if (!part.valid() || part.arc != other.arc || direct.to < direct.from || timeOf(direct) >= bestTime)
+					continue;
+				bestTime = timeOf(direct);
+				state.firstArc = direct;
+				state.lastArc = PartialArc();
+				source_id = target_id = g->head[part.arc];
+				path.clear();
+			}
+		}
+		return bestTime != inf_weight;
+	}
+
+	/**
+	 * @brief Calculates a route between two nodes, or between two positions on arcs if sourceArc and targetArc are given.
+	 */
+	Route* calculateRoute(unsigned long source_id, unsigned long target_id, float initialChargeInKwh, const ArcSnapResult* sourceArc, const ArcSnapResult* targetArc) const {
 		auto start_time = chrono::high_resolution_clock::now();
 		cout << "Calculating route..." << endl;
-		Route* evRoute = new Route(g);
+		RouteState state(g, initialChargeInKwh);
+		Route* evRoute = state.route.get();
+		RouteCounterScope counting(evRoute->counters);
+		TraceSpan routeSpan("calculateRoute");
+		vector<unsigned> firstPath; // Found while the directions are chosen
+		bool firstPathKnown = false;
+		if (sourceArc != nullptr) {
+			evRoute->origin = make_unique<Point>(sourceArc->latitude, sourceArc->longitude);
+			evRoute->destination = make_unique<Point>(targetArc->latitude, targetArc->longitude);
+			firstPathKnown = chooseArcDirections(state, *sourceArc, *targetArc, source_id, target_id, firstPath);
+			if (!firstPathKnown) { // No direction of the arcs connects them, e.g. they lie in different components
+				evRoute->fail = true;
+				return state.route.release();
+			}
+		}
 
-		while (source_id != target_id) { // Start an iterative search for the route
-			ContractionHierarchyQuery ch_query(g.ch);
-			ch_query.reset().add_source(source_id).add_target(target_id).run(); // Calculate the complete route
-			vector<unsigned> edges = ch_query.get_arc_path();
-			vector<float> soc = { car.currentChargeInKwh };
+		bool firstLeg = true;
+		bool arrived = false;
+		while (!arrived) { // Start an iterative search for the route
+			bool startsOnArc = firstLeg && state.firstArc.valid(); // The leg begins within the arc of the source
+			if (source_id == target_id && !startsOnArc && !state.lastArc.valid())
+				break;
+			TraceSpan iterationSpan("routeIteration", "leg", evRoute->route.size());
+			vector<unsigned> edges;
+			if (startsOnArc)
+				edges.push_back(state.firstArc.arc);
+			if (firstPathKnown) {
+				edges.insert(edges.end(), firstPath.begin(), firstPath.end());
+				firstPathKnown = false;
+			} else if (source_id != target_id && !appendArcPath(evRoute, source_id, target_id, edges)) { // Calculate the complete route
+				evRoute->fail = true; // The target cannot be reached at all
+				return state.route.release();
+			}
+			if (state.lastArc.valid())
+				edges.push_back(state.lastArc.arc);
+			// The driven share of the arc at position e of a leg, which ends at legTo on its last arc
+			auto shareOf = [&](const vector<unsigned>& leg, size_t e, float legTo) {
+				float from = 0.0f, to = e + 1 == leg.size() ? legTo : 1.0f;
+				if (e == 0 && startsOnArc) {
+					from = state.firstArc.from;
+					to = min(to, state.firstArc.to); // A target on the same arc ends the first arc early
+				}
+				return to - from;
+			};
+			vector<float>& soc = ctx->soc;
+			soc.assign(1, state.currentChargeInKwh);
 			// Define variables for later use
 			float lengthInMeters = 0.0;
 			float travelTimeInSeconds = 0.0;
-			float socAtStart = car.currentChargeInKwh;
-			set<ChargingPark*> blacklist;
-			pair<ChargingPark*, float> bestPark = make_pair(nullptr, std::numeric_limits<float>::max()); // this stores our current optimal charger
+			float socAtStart = state.currentChargeInKwh;
+			pair<unsigned, float> bestPark = make_pair(invalid_id, std::numeric_limits<float>::max()); // this stores our current optimal charger
 			// Compute remaining SoC after each edge on the path
-			for (auto edge : edges) {
-				float distance = g.distanceInMeter(edge);
-				float time = g.travelTimeInSec(edge);
-				soc.push_back(car.socAfterEdge(soc[soc.size() - 1], time, distance));
+			{
+				StageTimer timer(evRoute->stageTimes, STAGE_CONSUMPTION);
+				float legTo = state.lastArc.valid() ? state.lastArc.to : 1.0f;
+				for (size_t e = 0; e < edges.size(); ++e)
+					soc.push_back(socAfterArc(soc[soc.size() - 1], edges[e], shareOf(edges, e, legTo)));
 			}
 			// Check if the destination can be reached
-			if (soc[(soc.size() - 1)] >= car.minChargeAtDestinationInkWh) { // The destination can be reached with the current charge
+			if (soc[(soc.size() - 1)] >= profile->minChargeAtDestinationInkWh) { // The destination can be reached with the current charge
 				evRoute->route.push_back(edges);
-				for (auto edge : edges) {
-					evRoute->lengthInMeters += g.distanceInMeter(edge);
-					evRoute->travelTimeInSeconds += g.travelTimeInSec(edge);
+				float legTo = state.lastArc.valid() ? state.lastArc.to : 1.0f;
+				for (size_t e = 0; e < edges.size(); ++e) {
+					float share = shareOf(edges, e, legTo);
+					evRoute->lengthInMeters += g->distanceInMeter(edges[e]) * share;
+					evRoute->travelTimeInSeconds += g->travelTimeInSec(edges[e]) * share;
 				}
 				evRoute->batteryConsumptionInkWh += socAtStart - soc[soc.size()-1];
 				evRoute->remainingChargeAtArrivalInkWh = soc[soc.size()-1];
-				source_id = target_id; // This will result in a termination of the loop.
+				arrived = true; // This will result in a termination of the loop.
 				continue; 
 			}
+			if (startsOnArc) // The charging parks are rated from the first node
+				state.currentChargeInKwh = soc[1];
 			// In case the destination cannot be reached, a charger must be found:
 			int i; // Go to the point on the route where the vehicle has at least minChargeAtChargingStopsInkWh remaining. This point might be the destination!
 			for (i = 0; i < soc.size(); ++i)
-				if (soc[i] <= car.minChargeAtChargingStopsInkWh || i == soc.size() - 1)
+				if (soc[i] <= profile->minChargeAtChargingStopsInkWh || i == soc.size() - 1)
 					break;
-			while (i >= 0 && (bestPark.first == nullptr || soc[i] < BACKTRACE_START_PCT * car.maxChargeInKwh)) {
-				unsigned edge = edges[i];
-				auto fromNode = g.tail[edge];
-				Point coordinates = Point(g.graph.latitude[fromNode], g.graph.longitude[fromNode]);
-				pair<ChargingPark*, double> parkCandidate = getBestChargingPark(&coordinates, source_id, target_id, &blacklist, bestPark.first == nullptr ? 0 : bestPark.first->getBestConnFor(car)->ratedPowerKw);
-				if (bestPark.first == nullptr) {
-					bestPark = parkCandidate; // If no charger has been found yet, the candidate ist the new best.
-				} else {
-					float bestKw = bestPark.first->getBestConnFor(car)->ratedPowerKw;
-					float candidateKw = parkCandidate.first->getBestConnFor(car)->ratedPowerKw;
-					if(bestKw < candidateKw || (bestKw == candidateKw && bestPark.second > parkCandidate.second))
-						bestPark = parkCandidate;
-                }
-				if (bestPark.first->getBestConnFor(car)->ratedPowerKw > BACKTRACE_END_KW)
-					break;
-				i--;
+			vector<unsigned>& candidates = ctx->stations;
+			candidates.clear();
+			// The park the leg starts from and the parks the route has charged at before are no candidates, driving
+			// there again would add an empty or a circular leg.
+			auto usable = [&](unsigned park) {
+				unsigned long node = g->chargers.node[park];
+				if (node == source_id)
+					return false;
+				for (const ChargeEvent* event : evRoute->chargeEvents)
+					if (g->chargers.node[event->park] == node)
+						return false;
+				return true;
+			};
+			{
+				StageTimer timer(evRoute->stageTimes, STAGE_CANDIDATE_SEARCH);
+				TraceSpan span("candidateSearch");
+				// Walk back along the route from the last position that can be reached. How far the backtrace goes only
+				// depends on the charging power of the parks, and only the parks with the highest power can win, so the
+				// candidates are collected first and then rated all at once. Once a park is found, the sweep skips the
+				// power tiers below it.
+				float bestKw = -1.0; // No park found yet
+				g->sweepChargersAlongPath(edges, soc, BACKTRACE_BUFFER_KM, i + 1, [&](size_t position, const vector<CorridorHit>& hits) {
+					countRouteEvent(COUNTER_BACKTRACE_ITERATIONS);
+					for (const CorridorHit& hit : hits) {
+						if (!usable(hit.park))
+							continue;
+						float ratedPower = g->chargers.bestKwFor(hit.park, *profile);
+						if (ratedPower > bestKw) {
+							candidates.clear();
+							bestKw = ratedPower;
+						}
+						if (ratedPower == bestKw)
+							candidates.push_back(hit.park);
+					}
+					if (bestKw > BACKTRACE_END_KW)
+						return -1.0f;
+					if (!candidates.empty() && position > 0 && soc[position - 1] >= BACKTRACE_START_PCT * profile->maxChargeInKwh)
+						return -1.0f;
+					return max(bestKw, 0.0f);
+				});
+			}
+			if (!candidates.empty()) {
+				// The first candidate with the lowest score wins, in the order of the walk back.
+				StageTimer timer(evRoute->stageTimes, STAGE_CH_QUERY);
+				const vector<float>& scores = rateChargingParks(state, candidates, source_id, target_id);
+				bestPark = make_pair(candidates[0], scores[0]);
+				for (size_t c = 1; c < candidates.size(); ++c)
+					if (scores[c] < bestPark.second)
+						bestPark = make_pair(candidates[c], scores[c]);
 			}
-			if (bestPark.first == nullptr) { // can't find a charger -> route fails
+			if (bestPark.first == invalid_id) { // can't find a charger -> route fails
 				evRoute->fail = true;
-				return evRoute;
+				return state.route.release();
 			}
 			// Drive from start to charging park:
-			ch_query.reset().add_source(source_id).add_target(bestPark.first->node).run(); // calculate route from start to charging park
-			edges = ch_query.get_arc_path();
-			for (auto edge : edges) { // save route from Start to ChargingPark as a leg in the result
-				float distance = g.distanceInMeter(edge);
-				float time = g.travelTimeInSec(edge);
-				lengthInMeters += distance;
-				travelTimeInSeconds += time;
-				car.currentChargeInKwh = car.socAfterEdge(car.currentChargeInKwh, time, distance);
+			edges.clear();
+			if (startsOnArc)
+				edges.push_back(state.firstArc.arc);
+			if (!appendArcPath(evRoute, source_id, g->chargers.node[bestPark.first], edges) || edges.empty()) { // calculate route from start to charging park
+				evRoute->fail = true; // Even the best park is in another component of the graph, or the route does not move
+				return state.route.release();
+			}
+			state.currentChargeInKwh = socAtStart;
+			{
+				StageTimer timer(evRoute->stageTimes, STAGE_CONSUMPTION);
+				for (size_t e = 0; e < edges.size(); ++e) { // save route from Start to ChargingPark as a leg in the result
+					float share = shareOf(edges, e, 1.0f);
+					lengthInMeters += g->distanceInMeter(edges[e]) * share;
+					travelTimeInSeconds += g->travelTimeInSec(edges[e]) * share;
+					state.currentChargeInKwh = socAfterArc(state.currentChargeInKwh, edges[e], share);
+				}
 			}
 			evRoute->route.push_back(edges);
 			evRoute->lengthInMeters += lengthInMeters;
 			evRoute->travelTimeInSeconds += travelTimeInSeconds;
 			// Charge at the charging station:
-			// Charge to 80 % but at most car.maxChargingTimeInSec seconds:
-			ChargingConnector* conn = bestPark.first->getBestConnFor(car);
-			ChargeEvent* chargeEvent = new ChargeEvent(bestPark.first, conn);
-			float targetChargeInkWh = car.maxChargeInKwh * 0.8;
-			chargeEvent->remainingChargeAtArrivalInkWh = car.currentChargeInKwh;
-			int chargingTime = car.time_needed(*conn, car.currentChargeInKwh, targetChargeInkWh);
-			// Check if required charging time exceeds charging time limit of the vehicle.
-			if (chargingTime > car.maxChargingTimeInSec) {
-				chargingTime = car.maxChargingTimeInSec;
-				targetChargeInkWh = car.chargeAfterTime(*conn, car.currentChargeInKwh, car.maxChargingTimeInSec);
+			// Charge to 80 % but at most profile->maxChargingTimeInSec seconds:
+			const ChargingConnector& conn = g->chargers.bestConnectorFor(bestPark.first, *profile);
+			ChargeEvent* chargeEvent = new ChargeEvent(&g->chargers, bestPark.first, &conn);
+			float targetChargeInkWh = profile->maxChargeInKwh * 0.8;
+			chargeEvent->remainingChargeAtArrivalInkWh = state.currentChargeInKwh;
+			int chargingTime;
+			{
+				StageTimer timer(evRoute->stageTimes, STAGE_CHARGING);
+				chargingTime = profile->time_needed(conn, state.currentChargeInKwh, targetChargeInkWh);
+				countRouteEvent(COUNTER_CHARGING_STEPS);
+				// Check if required charging time exceeds charging time limit of the vehicle.
+				if (chargingTime > profile->maxChargingTimeInSec) {
+					countRouteEvent(COUNTER_CHARGING_STEPS);
+					chargingTime = profile->maxChargingTimeInSec;
+					targetChargeInkWh = profile->chargeAfterTime(conn, state.currentChargeInKwh, profile->maxChargingTimeInSec);
+				}
 			}
 			chargeEvent->targetChargeInkWh = targetChargeInkWh;
 			chargeEvent->chargingTimeInSeconds = chargingTime;
@@ -217,16 +457,17 @@ public:
 			// add summary info to charge event.
 			chargeEvent->travelTimeInSeconds = travelTimeInSeconds;
 			chargeEvent->lengthInMeters = lengthInMeters;
-			chargeEvent->batteryConsumptionInkWh = socAtStart - car.currentChargeInKwh;
-			evRoute->batteryConsumptionInkWh += socAtStart - car.currentChargeInKwh;
-			car.currentChargeInKwh = targetChargeInkWh;
+			chargeEvent->batteryConsumptionInkWh = socAtStart - state.currentChargeInKwh;
+			evRoute->batteryConsumptionInkWh += socAtStart - state.currentChargeInKwh;
+			state.currentChargeInKwh = targetChargeInkWh;
 			evRoute->chargeEvents.emplace_back(chargeEvent);
 			// Start journey from ChargingPark to destination in next iteration.
-			source_id = bestPark.first->node;
+			source_id = g->chargers.node[bestPark.first];
+			firstLeg = false;
 		}
 		auto finish_time = chrono::high_resolution_clock::now();
         auto duration = chrono::duration_cast<chrono::milliseconds>(finish_time - start_time);
         cout << "Calculating route took " << duration.count() << " ms." << endl;
-		return evRoute;
+		return state.route.release();
 	}
 };
\ No newline at end of file
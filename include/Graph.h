@@ -7,23 +7,99 @@
 #include <routingkit/inverse_vector.h>
 #include <routingkit/timer.h>
 #include <routingkit/geo_position_to_node.h>
-#include "ChargingPark.h"
+#include "ChargerStore.h"
+#include "ChargerCsv.h"
+#include "ChargerIndex.h"
+#include "SnappingService.h"
+#include "SnapshotIO.h"
+#include "ArrayView.h"
+#include "TraceRecorder.h"
+#include "MappedFile.h"
+#include <memory>
+#include <mutex>
 using namespace RoutingKit;
 
 #define MIN_CHARGER_KW 0 // The minimum rated power that a charging station needs to be considered.
+#define GRAPH_SNAPSHOT_MAGIC "EVGRAPH" // Identifies the binary graph snapshot saved as <pbf>.snapshot
+#define CHARGER_SNAPSHOT_MAGIC "EVPARKS" // Identifies the binary charger catalog saved as <csv>.snapshot
+#define CHARGER_SNAP_RADIUS_IN_METERS 1000 // Charging parks further away from the road network are ignored.
+#define GRAPH_FINGERPRINT_SAMPLES 4096 // Nodes and arcs hashed to tell graphs apart
+
+struct Graph;
+
+/**
+ * @brief A reference-counted, read-only view of a fully loaded graph.
+ * The graph is loaded once and then only borrowed by EvRouting and Route, so no query ever copies it.
+ */
+typedef shared_ptr<const Graph> GraphSnapshot;
 
 struct Graph {
-    RoutingKit::SimpleOSMCarRoutingGraph graph;
-    std::vector<unsigned> tail;
+    // The arrays of the road network. They point into the mapped graph snapshot or into parsedGraph.
+    ArrayView<unsigned> first_out, head, travel_time, geo_distance, tail;
+    ArrayView<float> latitude, longitude;
     RoutingKit::ContractionHierarchy ch;
-    vector<ChargingPark*> chargingParks;
-    unordered_map<unsigned, ChargingPark*> parkMap;
+    ChargerStore chargers;
+    unordered_map<unsigned, unsigned> parkMap; // The park (position in chargers) at each node with a park
+    ChargerIndex chargerIndex;
+
+    // Owns the arrays of the road network, either as a mapped snapshot or as a freshly parsed graph.
+    MappedFile mappedGraph;
+    RoutingKit::SimpleOSMCarRoutingGraph parsedGraph;
+    std::vector<unsigned> parsedTail;
+
+    // Built on the first use, see snapper()
+    mutable once_flag snappingBuilt;
+    mutable unique_ptr<SnappingService> snapping;
+
+    Graph() = default;
+    Graph(const Graph&) = delete; // A graph is far too large to be copied by accident.
+    Graph& operator=(const Graph&) = delete;
+
+    unsigned node_count() const {
+        return first_out.size() - 1;
+    }
+
+    unsigned arc_count() const {
+        return head.size();
+    }
+
+    /**
+     * @brief Takes ownership of a parsed road network and points the arrays of this graph to it.
+     * 
+     * @param parsed The road network, e.g. parsed from a pbf file
+     */
+    void assignGraph(RoutingKit::SimpleOSMCarRoutingGraph parsed) {
+        parsedGraph = move(parsed);
+        parsedTail = invert_inverse_vector(parsedGraph.first_out);
+        first_out = parsedGraph.first_out;
+        head = parsedGraph.head;
+        travel_time = parsedGraph.travel_time;
+        geo_distance = parsedGraph.geo_distance;
+        latitude = parsedGraph.latitude;
+        longitude = parsedGraph.longitude;
+        tail = parsedTail;
+    }
+
+    /**
+     * @brief Loads the graph and the charging stations and freezes them into a snapshot.
+     * 
+     * @param pbf_file The OSM file of the road network
+     * @param charger_file The csv file with the charging stations
+     * @param precomputed Whether the contraction hierarchy has already been saved next to the pbf_file
+     * @return GraphSnapshot that can be shared by any number of routing queries.
+     */
+    static GraphSnapshot load(string pbf_file, string charger_file, bool precomputed = false) {
+        auto g = make_shared<Graph>();
+        g->loadGraph(pbf_file, precomputed);
+        g->loadChargers(charger_file);
+        return g;
+    }
 
     void loadGraph(string pbf_file, bool precomputed = false) {
+        TraceSpan span("loadGraph");
         auto setup_start_time = chrono::high_resolution_clock::now();
         cout << "Loading graph..." << endl;
-        graph = simple_load_osm_car_routing_graph_from_pbf(pbf_file);
-        tail = invert_inverse_vector(graph.first_out);
+        bool fromSnapshot = loadRoadNetwork(pbf_file);
 
         auto graphDuration = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - setup_start_time);
         cout << "Loading took " << graphDuration.count() / 1000 << " s." << endl;
@@ -31,11 +107,12 @@ struct Graph {
         // Build the shortest path index
         cout << "Building shortest path index..." << endl;
         string ch_save = pbf_file + ".ch";
-        // bool precomputed = boost::filesystem::exists(ch_save); // If you have boost, you can uncomment this and remove the parameter.
-        ch = precomputed ? ContractionHierarchy::load_file(ch_save) : ContractionHierarchy::build(
-            graph.node_count(), 
-            tail, graph.head, 
-            graph.travel_time
+        // A CH next to a still valid snapshot belongs to the same graph, so it can be reused even if precomputed is not set.
+        precomputed = precomputed || (fromSnapshot && filesystem::exists(ch_save));
+        ch = precomputed ? loadContractionHierarchy(ch_save) : ContractionHierarchy::build(
+            node_count(), 
+            tail.toVector(), head.toVector(), 
+            travel_time.toVector()
         );
 
         if (!precomputed) ch.save_file(ch_save);
@@ -46,71 +123,423 @@ struct Graph {
         cout << "Graph setup took " << duration.count() / 1000 << " s." << endl;
     }
 
-    void loadChargers(string path) {
-        cout << "Loading charging stations..." << endl;
-        auto start_time = chrono::high_resolution_clock::now();
-        GeoPositionToNode map_geo_position(graph.latitude, graph.longitude);
-        ifstream file(path);
-        string line;
-        getline(file, line); // skip first line
-        while (getline(file, line)) {
-            //id,name,entry_lat,entry_lon,lat,lon,kws,types,currentTypes
-            vector<string> csv = split(line, ",", true);
-            if (csv[6] == "" || csv[7] == "" || csv[8] == "")
-                continue;
-            long long id = stoll(csv[0]);
-            string name = csv[1];
-            Point* location = new Point(stod(csv[4]), stod(csv[5]));
+    /**
+     * @brief Loads the road network from its snapshot, or parses the pbf file and saves the snapshot.
+     * 
+     * @param pbf_file The OpenStreetMap file, it does not need to exist if there is a snapshot
+     * @return true if the road network was loaded from the snapshot.
+     */
+    bool loadRoadNetwork(string pbf_file) {
+        string snapshot = pbf_file + ".snapshot";
+        if (isSnapshotValid(snapshot, GRAPH_SNAPSHOT_MAGIC, pbf_file) && loadGraphSnapshot(snapshot))
+            return true;
+        assignGraph(simple_load_osm_car_routing_graph_from_pbf(pbf_file));
+        saveGraphSnapshot(snapshot, pbf_file);
+        return false;
+    }
 
-            vector<string> kws = split(csv[6], "|", false);
-            vector<string> types = split(csv[7], "|", false);
-            vector<string> currentTypes = split(csv[8], "|", false);
+    /**
+     * @brief Saves the road network so the next start does not need to parse the pbf file again.
+     * 
+     * @param snapshot The file to write
+     * @param pbf_file The file the graph was parsed from
+     */
+    void saveGraphSnapshot(string snapshot, string pbf_file) const {
+        saveSnapshot(snapshot, SnapshotHeader(GRAPH_SNAPSHOT_MAGIC, pbf_file), [&](ostream& out) {
+            writeSnapshotVector(out, first_out);
+            writeSnapshotVector(out, head);
+            writeSnapshotVector(out, travel_time);
+            writeSnapshotVector(out, geo_distance);
+            writeSnapshotVector(out, latitude);
+            writeSnapshotVector(out, longitude);
+            writeSnapshotVector(out, tail);
+        });
+    }
 
-            if(kws.size() == 0 || types.size() != kws.size() || types.size() != currentTypes.size())
-                continue;
+    /**
+     * @brief Checks a range table of a snapshot like first_out or nameFirst.
+     * 
+     * @param first The start of each range and the end of the last one
+     * @param end The size of the array the ranges point into
+     * @return true if the table starts at 0, never decreases and ends at end.
+     */
+    static bool validRanges(ArrayView<unsigned> first, size_t end) {
+        if (first.empty() || first[0] != 0 || first[first.size() - 1] != end)
+            return false;
+        for (size_t i = 0; i + 1 < first.size(); ++i)
+            if (first[i] > first[i + 1])
+                return false;
+        return true;
+    }
 
-            if (max(kws) < MIN_CHARGER_KW)
-                continue;
+    /**
+     * @brief Maps the graph snapshot into memory and uses its arrays in place, so loading takes no time
+     * and processes on the same host share the pages.
+     * 
+     * @param snapshot The file to map
+     * @return false if the snapshot is corrupt, the arrays of the road network are empty then.
+     */
+    bool loadGraphSnapshot(string snapshot) {
+        mappedGraph = MappedFile(snapshot);
+        SnapshotReader in(mappedGraph);
+        bool valid = true;
+        try {
+            first_out = in.viewVector<unsigned>();
+            head = in.viewVector<unsigned>();
+            travel_time = in.viewVector<unsigned>();
+            geo_distance = in.viewVector<unsigned>();
+            latitude = in.viewVector<float>();
+            longitude = in.viewVector<float>();
+            tail = in.viewVector<unsigned>();
+        } catch (const runtime_error&) { // Truncated within, although the file size matches its header
+            valid = false;
+        }
+        size_t nodes = latitude.size(), arcs = head.size();
+        valid = valid && first_out.size() == nodes + 1 && longitude.size() == nodes && travel_time.size() == arcs
+            && geo_distance.size() == arcs && tail.size() == arcs && validRanges(first_out, arcs);
+        // Every arc must start at the node whose range contains it and end at an existing node.
+        for (size_t n = 0; valid && n < nodes; ++n)
+            for (unsigned a = first_out[n]; valid && a < first_out[n + 1]; ++a)
+                valid = tail[a] == n && head[a] < nodes;
+        if (!valid) {
+            cout << "Graph snapshot \"" << snapshot << "\" is corrupt and is rebuilt." << endl;
+            first_out = head = travel_time = geo_distance = tail = {};
+            latitude = longitude = {};
+            mappedGraph = MappedFile();
+        }
+        return valid;
+    }
+
+    /**
+     * @brief Reads the contraction hierarchy straight from a mapped file instead of through a stream.
+     * RoutingKit stores the hierarchy in vectors, so it still needs to be copied once.
+     * 
+     * @param ch_save The file written by ContractionHierarchy::save_file
+     */
+    static ContractionHierarchy loadContractionHierarchy(string ch_save) {
+        MappedFile file(ch_save);
+        const char* pos = file.data();
+        return ContractionHierarchy::read([&](char* buffer, unsigned long long size) {
+            memcpy(buffer, pos, size);
+            pos += size;
+        }, file.size());
+    }
 
-            auto park = new ChargingPark(id, name, location);
-            float entry_lat = stod(csv[2]);
-            float entry_lon =  stod(csv[3]);
-            unsigned node = map_geo_position.find_nearest_neighbor_within_radius(entry_lat, entry_lon, 1000).id;
-            park->node = node;
-            chargingParks.push_back(park);
-            parkMap[node] = park;
-            for (int i = 0; i < kws.size(); ++i)
-                chargingParks.back()->connectors.push_back(
-                    new ChargingConnector(types[i], stof(kws[i]), currentTypes[i])
-                );
+    void loadChargers(string path) {
+        TraceSpan span("loadChargers");
+        cout << "Loading charging stations..." << endl;
+        auto start_time = chrono::high_resolution_clock::now();
+        string snapshot = path + ".snapshot";
+        if (!isSnapshotValid(snapshot, CHARGER_SNAPSHOT_MAGIC, path) || !loadChargerSnapshot(snapshot)) {
+            parseChargers(path);
+            chargerIndex.build(chargers);
+            saveChargerSnapshot(snapshot, path);
         }
         auto finish_time = chrono::high_resolution_clock::now();
         auto duration = chrono::duration_cast<chrono::milliseconds>(finish_time - start_time);
         cout << "Loading charging stations took " << duration.count() / 1000 << " s." << endl;
     }
 
-    vector<ChargingPark*> findKNearestChargers(Point* p, int k, int maxDist) {
-        vector<ChargingPark*> all;
-        auto compare = [p](ChargingPark* a, ChargingPark* b) {
-            return (distance_in_km(p, a->location) < distance_in_km(p, b->location)); 
+    /**
+     * @brief Parses the charging parks from the csv file and snaps their entries to the graph.
+     * Rows with missing or malformed fields are skipped, and so are parks that are too far from the road network.
+     * 
+     * @param path The csv file of gatherEVStations.py
+     */
+    void parseChargers(string path) {
+        struct ParsedPark {
+            long long id;
+            string name;
+            double lat, lon;
+            vector<ChargingConnector> connectors;
+            pair<float, float> entry; // Snapped in single precision like before, so the parks keep their nodes
         };
-        for (auto park : chargingParks) {
-            if (distance_in_km(p, park->location) > maxDist)
-                continue;
-            all.push_back(park);
-            if (all.size() <= k)
+        vector<ParsedPark> parsed = parseChargerCsv<ParsedPark>(path, [&](const ChargerCsvRow& row, vector<ParsedPark>& parks) {
+            //id,name,entry_lat,entry_lon,lat,lon,kws,types,currentTypes
+            if (row.kws().empty() || row.types().empty() || row.currentTypes().empty())
+                return;
+            long long id;
+            double lat, lon, entry_lat, entry_lon;
+            if (!parseCsvNumber(row.id(), id) || !parseCsvNumber(row.lat(), lat) || !parseCsvNumber(row.lon(), lon)
+                || !parseCsvNumber(row.entryLat(), entry_lat) || !parseCsvNumber(row.entryLon(), entry_lon))
+                return;
+            static thread_local vector<string_view> kws, types, currentTypes;
+            splitCsvList(row.kws(), kws);
+            splitCsvList(row.types(), types);
+            splitCsvList(row.currentTypes(), currentTypes);
+            if (kws.size() == 0 || types.size() != kws.size() || types.size() != currentTypes.size())
+                return;
+            static thread_local vector<float> powers;
+            powers.resize(kws.size());
+            float maxKw = 0;
+            for (size_t i = 0; i < kws.size(); ++i) {
+                if (!parseCsvNumber(kws[i], powers[i]))
+                    return;
+                maxKw = max(maxKw, powers[i]);
+            }
+            if (maxKw < MIN_CHARGER_KW)
+                return;
+            ParsedPark park{id, string(row.name()), lat, lon, {}, make_pair(static_cast<float>(entry_lat), static_cast<float>(entry_lon))};
+            park.connectors.reserve(kws.size());
+            for (size_t i = 0; i < kws.size(); ++i)
+                park.connectors.emplace_back(string(types[i]), powers[i], string(currentTypes[i]));
+            parks.push_back(move(park));
+        });
+        vector<pair<float, float>> entries;
+        entries.reserve(parsed.size());
+        for (const ParsedPark& p : parsed)
+            entries.push_back(p.entry);
+        vector<SnapResult> snapped = snapper().snapAll(entries, CHARGER_SNAP_RADIUS_IN_METERS);
+        size_t unsnapped = 0;
+        for (size_t p = 0; p < parsed.size(); ++p) {
+            if (!snapped[p].ok()) { // The park cannot be reached, it would otherwise be routed to an invalid node.
+                ++unsnapped;
                 continue;
-            sort(all.begin(), all.end(), compare);
-            all.pop_back();
+            }
+            const ParsedPark& park = parsed[p];
+            parkMap[snapped[p].node] = chargers.add(park.id, park.name, park.lat, park.lon, snapped[p].node, park.connectors);
+        }
+        if (unsnapped > 0)
+            cout << unsnapped << " charging parks are further than " << CHARGER_SNAP_RADIUS_IN_METERS << " m from the road network and are ignored." << endl;
+    }
+
+    /**
+     * @brief Returns the snapping service of this graph. It is built on the first call and then shared by all threads.
+     * 
+     * @return The service that matches coordinates to nodes of this graph
+     */
+    const SnappingService& snapper() const {
+        call_once(snappingBuilt, [this] {
+            snapping = make_unique<SnappingService>(latitude, longitude, first_out, head);
+        });
+        return *snapping;
+    }
+
+    /**
+     * @brief Identifies the road network of this graph for the charger catalog.
+     * Hashes the size and a sample of the nodes and arcs, which is cheap and still detects a different graph of the
+     * same size.
+     * 
+     * @return The fingerprint of the graph
+     */
+    unsigned long long fingerprint() const {
+        unsigned long long hash = 14695981039346656037ull; // FNV-1a
+        auto add = [&](const void* data, size_t size) {
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ static_cast<const unsigned char*>(data)[i]) * 1099511628211ull;
+        };
+        unsigned nodes = node_count(), arcs = arc_count();
+        add(&nodes, sizeof(nodes));
+        add(&arcs, sizeof(arcs));
+        for (unsigned n = 0; n < nodes; n += max(1u, nodes / GRAPH_FINGERPRINT_SAMPLES)) {
+            add(&latitude[n], sizeof(float));
+            add(&longitude[n], sizeof(float));
+            add(&first_out[n], sizeof(unsigned));
         }
-        return all;
+        for (unsigned a = 0; a < arcs; a += max(1u, arcs / GRAPH_FINGERPRINT_SAMPLES))
+            add(&head[a], sizeof(unsigned));
+        return hash;
+    }
+
+    /**
+     * @brief Saves the charging parks as a binary catalog, together with the nodes they were snapped to and the charger index.
+     * The parks are stored as struct of arrays and the strings as string tables, so the catalog is read with a
+     * single mapping. It records the fingerprint of the graph, because the snapped nodes are only valid for that graph.
+     * 
+     * @param snapshot The file to write
+     * @param path The csv file the charging parks were parsed from
+     */
+    void saveChargerSnapshot(string snapshot, string path) const {
+        vector<float> kws;
+        vector<unsigned> typeOf, currentTypeOf; // Positions in the table of distinct connector types
+        vector<string> typeTable;
+        unordered_map<string, unsigned> typeIds;
+        auto typeId = [&](const string& type) {
+            auto found = typeIds.emplace(type, typeTable.size());
+            if (found.second)
+                typeTable.push_back(type);
+            return found.first->second;
+        };
+        for (const ChargingConnector& conn : chargers.connectors) {
+            kws.push_back(conn.ratedPowerKw);
+            typeOf.push_back(typeId(conn.connectorType));
+            currentTypeOf.push_back(typeId(conn.currentType));
+        }
+        saveSnapshot(snapshot, SnapshotHeader(CHARGER_SNAPSHOT_MAGIC, path), [&](ostream& out) {
+            write_value<unsigned long long>(out, fingerprint());
+            writeSnapshotVector(out, chargers.ids);
+            writeSnapshotVector(out, chargers.lat);
+            writeSnapshotVector(out, chargers.lon);
+            writeSnapshotVector(out, chargers.node);
+            writeSnapshotVector(out, chargers.nameFirst);
+            writeSnapshotString(out, chargers.names);
+            writeSnapshotVector(out, chargers.connectorFirst);
+            writeSnapshotVector(out, kws);
+            writeSnapshotVector(out, typeOf);
+            writeSnapshotVector(out, currentTypeOf);
+            write_value<unsigned long long>(out, typeTable.size());
+            for (const string& type : typeTable)
+                writeSnapshotString(out, type);
+            // The charger index, its parks are stored as their positions in chargers.
+            write_value<double>(out, chargerIndex.latMin);
+            write_value<double>(out, chargerIndex.lonMin);
+            write_value<double>(out, chargerIndex.latMax);
+            write_value<double>(out, chargerIndex.lonMax);
+            write_value<int>(out, chargerIndex.rows);
+            write_value<int>(out, chargerIndex.cols);
+            writeSnapshotVector(out, chargerIndex.cellFirst);
+            writeSnapshotVector(out, chargerIndex.order);
+        });
+    }
+
+    /**
+     * @brief Loads the charging parks and the charger index from a binary catalog.
+     * Every position and range in the catalog is checked before it is used, so a damaged file is rebuilt instead of
+     * being read out of bounds.
+     * 
+     * @param snapshot The file to read
+     * @return false if the catalog was created for a different graph or is corrupt. Nothing is loaded in that case.
+     */
+    bool loadChargerSnapshot(string snapshot) {
+        MappedFile file(snapshot);
+        SnapshotReader in(file);
+        auto corrupt = [&]() {
+            cout << "Charger catalog \"" << snapshot << "\" is corrupt and is rebuilt." << endl;
+            return false;
+        };
+        try {
+            if (in.readValue<unsigned long long>() != fingerprint())
+                return false;
+            ArrayView<long long> ids = in.viewVector<long long>();
+            ArrayView<double> lats = in.viewVector<double>();
+            ArrayView<double> lons = in.viewVector<double>();
+            ArrayView<unsigned> nodes = in.viewVector<unsigned>();
+            ArrayView<unsigned> nameFirst = in.viewVector<unsigned>();
+            ArrayView<char> names = in.viewVector<char>();
+            ArrayView<unsigned> connectorFirst = in.viewVector<unsigned>();
+            ArrayView<float> kws = in.viewVector<float>();
+            ArrayView<unsigned> typeOf = in.viewVector<unsigned>();
+            ArrayView<unsigned> currentTypeOf = in.viewVector<unsigned>();
+            size_t parks = ids.size();
+            if (lats.size() != parks || lons.size() != parks || nodes.size() != parks || nameFirst.size() != parks + 1
+                || connectorFirst.size() != parks + 1 || typeOf.size() != kws.size() || currentTypeOf.size() != kws.size()
+                || !validRanges(nameFirst, names.size()) || !validRanges(connectorFirst, kws.size()))
+                return corrupt();
+            for (size_t p = 0; p < parks; ++p)
+                if (nodes[p] >= node_count() || connectorFirst[p] == connectorFirst[p + 1])
+                    return corrupt();
+            unsigned long long typeCount = in.readValue<unsigned long long>();
+            if (typeCount > 2 * kws.size()) // Each connector has two types
+                return corrupt();
+            vector<string> typeTable(typeCount);
+            for (string& type : typeTable)
+                type = in.readString();
+            for (size_t c = 0; c < kws.size(); ++c)
+                if (typeOf[c] >= typeCount || currentTypeOf[c] >= typeCount)
+                    return corrupt();
+            double latMin = in.readValue<double>(), lonMin = in.readValue<double>();
+            double latMax = in.readValue<double>(), lonMax = in.readValue<double>();
+            int rows = in.readValue<int>(), cols = in.readValue<int>();
+            ArrayView<unsigned> cellFirst = in.viewVector<unsigned>();
+            ArrayView<unsigned> order = in.viewVector<unsigned>();
+            if (order.size() != parks)
+                return corrupt();
+            if (parks > 0) {
+                if (rows <= 0 || cols <= 0 || cellFirst.size() != static_cast<size_t>(rows) * cols * CHARGER_POWER_TIERS + 1 || !validRanges(cellFirst, parks))
+                    return corrupt();
+                vector<bool> indexed(parks, false); // order must name every park exactly once
+                for (unsigned park : order) {
+                    if (park >= parks || indexed[park])
+                        return corrupt();
+                    indexed[park] = true;
+                }
+            }
+            vector<ChargingConnector> parkConnectors;
+            for (size_t p = 0; p < parks; ++p) {
+                parkConnectors.clear();
+                for (unsigned c = connectorFirst[p]; c < connectorFirst[p + 1]; ++c)
+                    parkConnectors.emplace_back(typeTable[typeOf[c]], kws[c], typeTable[currentTypeOf[c]]);
+                string_view name(names.data() + nameFirst[p], nameFirst[p + 1] - nameFirst[p]);
+                parkMap[nodes[p]] = chargers.add(ids[p], name, lats[p], lons[p], nodes[p], parkConnectors);
+            }
+            chargerIndex.restore(chargers, latMin, lonMin, latMax, lonMax, rows, cols, cellFirst.toVector(), order.toVector());
+            return true;
+        } catch (const runtime_error&) { // Truncated within, although the file size matches its header
+            return corrupt();
+        }
+    }
+
+    /**
+     * @brief Finds the k nearest charging parks to a point with the charger index.
+     * 
+     * @param p The point to search around
+     * @param k The maximum number of parks to return
+     * @param maxDist Parks that are further away (in km) are ignored
+     * @param minKw Parks whose best connector has less power are ignored, the slower power tiers are not even scanned
+     * @return The positions of the parks in chargers, sorted by their distance to p.
+     */
+    vector<unsigned> findKNearestChargers(Point* p, int k, int maxDist, float minKw = 0.0) const {
+        countRouteEvent(COUNTER_NEAREST_CHARGER_CALLS);
+        return chargerIndex.findKNearest(p, k, maxDist, minKw);
+    }
+
+    /**
+     * @brief Finds all charging parks within a radius around a point.
+     * 
+     * @param p The point to search around
+     * @param radius The search radius in km
+     * @param minKw Parks whose best connector has less power are ignored
+     * @return The positions of the parks in chargers, sorted by their distance to p.
+     */
+    vector<unsigned> findChargersWithinRadius(Point* p, double radius, float minKw = 0.0) const {
+        return chargerIndex.findWithinRadius(p, radius, minKw);
+    }
+
+    /**
+     * @brief Returns the distinct rated powers of all connectors, e.g. to compile the charging curves of a vehicle for them.
+     *
+     * @return The powers in kW in ascending order.
+     */
+    vector<float> connectorPowers() const {
+        vector<float> powers;
+        for (const ChargingConnector& conn : chargers.connectors)
+            powers.push_back(conn.ratedPowerKw);
+        sort(powers.begin(), powers.end());
+        powers.erase(unique(powers.begin(), powers.end()), powers.end());
+        return powers;
+    }
+
+    /**
+     * @brief Walks back along a path and reports the charging parks within a buffer around it, see ChargerIndex::sweepAlongPolyline().
+     * Position i of the path is the start of edges[i], the last position is the end of the last edge.
+     * 
+     * @param edges The arc path, e.g. from ContractionHierarchyQuery::get_arc_path()
+     * @param soc The state of charge at each position of the path
+     * @param bufferInKm The maximum distance between a park and the path
+     * @param positionCount The sweep starts at position positionCount - 1
+     * @param visit Called with each position and its parks, with the state of charge there. Returns the minimum power
+     * of the parks at the following positions, or a negative value to stop.
+     */
+    template<class Visit>
+    void sweepChargersAlongPath(const vector<unsigned>& edges, const vector<float>& soc, double bufferInKm, size_t positionCount, const Visit& visit) const {
+        if (edges.empty())
+            return;
+        positionCount = min(positionCount, edges.size() + 1);
+        chargerIndex.sweepAlongPolyline(positionCount, [&](size_t i) {
+            unsigned node = i < edges.size() ? tail[edges[i]] : head[edges.back()];
+            return make_pair<double, double>(latitude[node], longitude[node]);
+        }, bufferInKm, [&](size_t i, vector<CorridorHit>& hits) {
+            for (CorridorHit& hit : hits)
+                hit.socInKwh = soc[i];
+            return visit(i, hits);
+        });
     }
 
-    float travelTimeInSec(unsigned edge) {
-        return graph.travel_time[edge] / 1000.0;
+    float travelTimeInSec(unsigned edge) const {
+        return travel_time[edge] / 1000.0;
     }
 
-    float distanceInMeter(unsigned edge) {
-        return graph.geo_distance[edge];
+    float distanceInMeter(unsigned edge) const {
+        return geo_distance[edge];
     }
 };
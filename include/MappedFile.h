@@ -0,0 +1,103 @@
+/**
+ * @file MappedFile.h
+ * @brief Maps a file read-only into memory.
+ * The pages are shared with every other process that maps the same file, so several routing processes on one host
+ * only keep one copy of a snapshot in physical memory. On Windows the file is read into memory instead.
+ */
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fstream>
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+class MappedFile {
+private:
+	const char* bytes = nullptr;
+	size_t length = 0;
+#ifdef WINDOWS
+	vector<char> buffer;
+#endif
+
+	void unmap() {
+#ifndef WINDOWS
+		if (bytes != nullptr && length > 0)
+			munmap(const_cast<char*>(bytes), length);
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+public:
+	MappedFile() {}
+
+	/**
+	 * @brief Maps the whole file into memory.
+	 * 
+	 * @param path The file to map
+	 * @throws runtime_error if the file cannot be opened or mapped.
+	 */
+	explicit MappedFile(const string& path) {
+#ifdef WINDOWS
+		ifstream in(path, ios::binary | ios::ate);
+		if (!in)
+			throw runtime_error("Can not open \"" + path + "\" for reading.");
+		buffer.resize(in.tellg());
+		in.seekg(0);
+		in.read(buffer.data(), buffer.size());
+		bytes = buffer.data();
+		length = buffer.size();
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw runtime_error("Can not open \"" + path + "\" for reading.");
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			throw runtime_error("Can not stat \"" + path + "\".");
+		}
+		length = info.st_size;
+		if (length > 0) {
+			void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED) {
+				close(fd);
+				throw runtime_error("Can not map \"" + path + "\" into memory.");
+			}
+			bytes = static_cast<const char*>(mapping);
+		}
+		close(fd); // The mapping stays valid after closing the descriptor.
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) { *this = move(other); }
+
+	MappedFile& operator=(MappedFile&& other) {
+		if (this != &other) {
+			unmap();
+			bytes = other.bytes;
+			length = other.length;
+#ifdef WINDOWS
+			buffer = move(other.buffer);
+#endif
+			other.bytes = nullptr;
+			other.length = 0;
+		}
+		return *this;
+	}
+
+	~MappedFile() { unmap(); }
+
+	const char* data() const { return bytes; }
+	size_t size() const { return length; }
+};
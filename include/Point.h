@@ -27,11 +27,11 @@ inline long double toRadians(const long double degree) {
 	return M_PI / 180 * degree;
 }
 
-long double distance_in_km(Point* p, Point* q) {
-	long double p_lat = toRadians(p->lat);
-	long double p_lon = toRadians(p->lon);
-	long double q_lat = toRadians(q->lat);
-	long double q_lon = toRadians(q->lon);
+long double distance_in_km(double pLat, double pLon, double qLat, double qLon) {
+	long double p_lat = toRadians(pLat);
+	long double p_lon = toRadians(pLon);
+	long double q_lat = toRadians(qLat);
+	long double q_lon = toRadians(qLon);
 	// Haversine Formula
 	long double dlong = q_lon - p_lon;
 	long double dlat = q_lat - p_lat;
@@ -42,4 +42,8 @@ long double distance_in_km(Point* p, Point* q) {
 	long double R = 6371;
 	ans = ans * R;
 	return ans;
+}
+
+long double distance_in_km(Point* p, Point* q) {
+	return distance_in_km(p->lat, p->lon, q->lat, q->lon);
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+/**
+ * @file QueryContext.h
+ * @brief Defines the scratch memory that a route calculation needs.
+ * Creating a ContractionHierarchyQuery allocates and initialises several arrays with one entry per node, so every
+ * worker thread should allocate one QueryContext and reuse it for all of its queries.
+ */
+#pragma once
+
+#include "Graph.h"
+#include <vector>
+
+using namespace std;
+
+struct QueryContext {
+	ContractionHierarchyQuery chQuery;
+	vector<float> soc; // State of charge along the current path
+	vector<unsigned> stations; // Candidates of the backtrace, as positions in the ChargerStore
+	// Buffers of the one-to-many candidate rating
+	vector<unsigned> parkNodes, timeToPark, timeFromPark;
+	vector<float> energyToPark, scores;
+	vector<float> energyTmp; // One entry per node, needed by the extra weight queries
+	vector<unsigned> chunkNodes; // Parks of one search of the candidate rating
+	vector<float> chunkEnergy;
+
+	QueryContext() {}
+
+	explicit QueryContext(const Graph& g) {
+		attach(g);
+	}
+
+	/**
+	 * @brief Prepares the context for queries on the given graph. This only allocates if the graph changed.
+	 * 
+	 * @param g The graph that the next queries run on
+	 */
+	void attach(const Graph& g) {
+		if (chQuery.ch == &g.ch)
+			return;
+		chQuery.reset(g.ch);
+		energyTmp.resize(g.ch.node_count());
+	}
+};
@@ -0,0 +1,131 @@
+/**
+ * @file RouteCounters.h
+ * @brief Counts how often the loops of a route calculation run.
+ * Every thread counts into its own slot, so counting never locks or contends. A route takes the difference of the
+ * counters of its thread before and after its calculation, and processCounters() sums the slots of all threads.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+enum RouteCounter {
+	COUNTER_CH_QUERIES, // Shortest path searches, a one-to-many search counts once
+	COUNTER_ARCS_UNPACKED, // Arcs of the unpacked paths
+	COUNTER_NEAREST_CHARGER_CALLS, // Calls of findKNearestChargers
+	COUNTER_PARKS_SCANNED, // Parks looked at by the charger index
+	COUNTER_HAVERSINES, // Exact distances computed by the charger index
+	COUNTER_CANDIDATES_RATED, // Charging parks rated by their detour
+	COUNTER_BACKTRACE_ITERATIONS, // Positions of the route visited by the backtrace
+	COUNTER_CHARGING_STEPS, // Evaluations of the charging curve
+	COUNTER_COUNT
+};
+
+inline const char* const ROUTE_COUNTER_NAMES[COUNTER_COUNT] = {"chQueries", "arcsUnpacked", "nearestChargerCalls", "parksScanned", "haversines", "candidatesRated", "backtraceIterations", "chargingSteps"};
+
+struct RouteCounters {
+	uint64_t values[COUNTER_COUNT] = {};
+
+	RouteCounters& operator+=(const RouteCounters& other) {
+		for (int c = 0; c < COUNTER_COUNT; ++c)
+			values[c] += other.values[c];
+		return *this;
+	}
+
+	RouteCounters operator-(const RouteCounters& other) const {
+		RouteCounters difference;
+		for (int c = 0; c < COUNTER_COUNT; ++c)
+			difference.values[c] = values[c] - other.values[c];
+		return difference;
+	}
+
+	json toJson() const {
+		json result;
+		for (int c = 0; c < COUNTER_COUNT; ++c)
+			result[ROUTE_COUNTER_NAMES[c]] = values[c];
+		return result;
+	}
+};
+
+/**
+ * @brief The counters of one thread. Only the owning thread writes them, other threads only read them for a snapshot,
+ * so a relaxed load and store is enough and no read-modify-write is needed.
+ */
+struct ThreadCounterSlot {
+	atomic<uint64_t> values[COUNTER_COUNT] = {};
+
+	void add(RouteCounter counter, uint64_t amount) {
+		values[counter].store(values[counter].load(memory_order_relaxed) + amount, memory_order_relaxed);
+	}
+
+	RouteCounters read() const {
+		RouteCounters counters;
+		for (int c = 0; c < COUNTER_COUNT; ++c)
+			counters.values[c] = values[c].load(memory_order_relaxed);
+		return counters;
+	}
+};
+
+/**
+ * @brief Keeps the slots of all threads, also of threads that have finished, so the process totals never go back.
+ */
+struct CounterRegistry {
+	mutex lock;
+	vector<shared_ptr<ThreadCounterSlot>> slots;
+
+	static CounterRegistry& instance() {
+		static CounterRegistry registry;
+		return registry;
+	}
+};
+
+/**
+ * @brief Returns the counters of the calling thread. The slot is registered on the first call of each thread.
+ */
+inline ThreadCounterSlot& threadCounters() {
+	static thread_local shared_ptr<ThreadCounterSlot> slot = [] {
+		auto created = make_shared<ThreadCounterSlot>();
+		CounterRegistry& registry = CounterRegistry::instance();
+		lock_guard<mutex> guard(registry.lock);
+		registry.slots.push_back(created);
+		return created;
+	}();
+	return *slot;
+}
+
+inline void countRouteEvent(RouteCounter counter, uint64_t amount = 1) {
+	threadCounters().add(counter, amount);
+}
+
+/**
+ * @brief Sums the counters of all threads since the start of the process.
+ */
+inline RouteCounters processCounters() {
+	CounterRegistry& registry = CounterRegistry::instance();
+	lock_guard<mutex> guard(registry.lock);
+	RouteCounters total;
+	for (auto& slot : registry.slots)
+		total += slot->read();
+	return total;
+}
+
+/**
+ * @brief Adds everything the calling thread counts between its construction and its destruction to a route.
+ */
+struct RouteCounterScope {
+	RouteCounters& counters;
+	RouteCounters start;
+
+	RouteCounterScope(RouteCounters& _counters) : counters{_counters}, start{threadCounters().read()} {}
+
+	~RouteCounterScope() {
+		counters += threadCounters().read() - start;
+	}
+};
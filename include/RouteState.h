@@ -0,0 +1,42 @@
+/**
+ * @file RouteState.h
+ * @brief Defines the state of a single route calculation.
+ * Everything that changes while a route is calculated lives here, so the vehicle profile and the routing itself can be
+ * shared by any number of queries.
+ */
+#pragma once
+
+#include "Graph.h"
+#include "RoutingResult.h"
+#include <memory>
+#include <routingkit/constants.h>
+
+using namespace std;
+
+/**
+ * @brief The part of an arc that a route drives when it starts or ends between two nodes.
+ */
+struct PartialArc {
+	unsigned arc = RoutingKit::invalid_id; // invalid_id if the route starts or ends at a node
+	float from = 0.0; // The driven part of the arc, 0 is its tail and 1 its head
+	float to = 1.0;
+
+	bool valid() const {
+		return arc != RoutingKit::invalid_id;
+	}
+};
+
+struct RouteState {
+	float currentChargeInKwh; // State of charge at the start of the current leg
+	unique_ptr<Route> route; // The legs that have been calculated so far
+	PartialArc firstArc; // Driven before the first node of the route
+	PartialArc lastArc; // Driven after the last node of the route
+
+	/**
+	 * @brief Starts a new route.
+	 *
+	 * @param g The graph of the route
+	 * @param initialChargeInKwh The state of charge at the start of the route
+	 */
+	RouteState(GraphSnapshot g, float initialChargeInKwh) : currentChargeInKwh{initialChargeInKwh}, route{make_unique<Route>(g)} {}
+};
@@ -2,6 +2,10 @@
 #include <list>
 #include "Graph.h"
 #include "ChargeEvent.h"
+#include "Point.h"
+#include "RouteCounters.h"
+#include "StageTimer.h"
+#include "TraceRecorder.h"
 #include "json.hpp"
 using json = nlohmann::json;
 
@@ -12,33 +16,50 @@ struct Route {
 	float travelTimeInSeconds = 0.0;
 	float remainingChargeAtArrivalInkWh = 0.0;
 	float totalChargingTimeInSeconds = 0.0;
-	Graph g;
+	GraphSnapshot g; // Only borrowed to resolve the coordinates of the route.
 	vector<vector<unsigned>> route; // Array of arrays since each segment of the route to a charging stop is its own element
 	vector<ChargeEvent*> chargeEvents;
+	StageTimes stageTimes; // Where the calculation spent its time, not part of the JSON
+	RouteCounters counters; // How often the loops of the calculation ran, not part of the JSON
+	unique_ptr<Point> origin, destination; // Set if the route starts or ends between two nodes, they replace the first point and the last point of a route that arrives.
 
-	Route(Graph _g) : g{_g} {};
+	Route(GraphSnapshot _g) : g{_g} {};
+	Route(const Route&) = delete;
+	Route& operator=(const Route&) = delete;
+
+	~Route() {
+		for (ChargeEvent* chargeEvent : chargeEvents)
+			delete chargeEvent;
+	}
 
 	json toJson() {
+		TraceSpan span("toJson", "legs", route.size());
 		json result;
 		if (fail)
 			result["fail"] = true;
 		vector<json> legs;
 		for (size_t idx = 0; idx < route.size(); ++idx) { // Iterate legs:
 			auto leg = route[idx];
+			if (leg.empty()) // A leg without arcs has no points
+				continue;
 			json legjson;
 			vector<json> points;
 			for (auto edge : leg) { // Iterate edges of leg and insert "from" node
 				json point;
-				unsigned long node = g.tail[edge];
-				point["latitude"] = g.graph.latitude[node];
-				point["longitude"] = g.graph.longitude[node];
+				unsigned long node = g->tail[edge];
+				point["latitude"] = g->latitude[node];
+				point["longitude"] = g->longitude[node];
 				points.emplace_back(point);
 			}
 			json lastPoint;
-			unsigned long lastNode = g.graph.head[leg.back()];
-			lastPoint["latitude"] = g.graph.latitude[lastNode];
-			lastPoint["longitude"] = g.graph.longitude[lastNode];
+			unsigned long lastNode = g->head[leg.back()];
+			lastPoint["latitude"] = g->latitude[lastNode];
+			lastPoint["longitude"] = g->longitude[lastNode];
 			points.emplace_back(lastPoint); // Add target from last edge.
+			if (idx == 0 && origin)
+				points.front() = origin->toJson();
+			if (idx == route.size() - 1 && destination && !fail) // A failed route ends at the park where it got stuck
+				points.back() = destination->toJson();
 			legjson["points"] = points;
 			if (idx < chargeEvents.size())
 				legjson["summary"] = chargeEvents[idx]->toJson();
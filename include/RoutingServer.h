@@ -0,0 +1,225 @@
+/**
+ * @file RoutingServer.h
+ * @brief A minimal HTTP/1.1 server that answers route requests on a local port.
+ * The graph and the charging parks are loaded once, so a request only costs the route calculation itself.
+ * Endpoints:
+ *   POST /route  with a request in the format of RoutingService::route() as body, answers with the route as JSON
+ *   GET  /health answers {"status": "ok"}
+ *   GET  /stats  answers the counters of all routes since the start, see RouteCounters.h
+ *   GET  /trace  answers the timeline of the latest route calculations in the Chrome trace event format, see TraceRecorder.h
+ * Every connection is answered once and then closed. The connections are handled by a fixed pool of workers, each
+ * with its own query workspace. At most SERVER_CONNECTIONS_PER_WORKER connections per worker are open at a time, further
+ * ones are answered with 503 right away.
+ */
+#pragma once
+
+#ifndef WINDOWS
+
+#include "RoutingService.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "json.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+using namespace std;
+
+#define SERVER_MAX_REQUEST_BYTES (1 << 20) // Larger requests are rejected.
+#define SERVER_TIMEOUT_IN_SEC 10 // Connections that do not send their request within this time are closed.
+#define SERVER_CONNECTIONS_PER_WORKER 4 // Connections that are queued or handled per worker before new ones are rejected.
+
+class RoutingServer {
+private:
+	RoutingService& service;
+	int listenSocket = -1;
+	atomic<size_t> inFlight{0}; // Connections that are queued or handled
+
+	static void sendResponse(int connection, int status, const string& reason, const string& body) {
+		string response = "HTTP/1.1 " + to_string(status) + " " + reason + "\r\n"
+			"Content-Type: application/json\r\n"
+			"Content-Length: " + to_string(body.size()) + "\r\n"
+			"Connection: close\r\n\r\n" + body;
+		size_t sent = 0;
+		while (sent < response.size()) {
+			ssize_t n = send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+				return;
+			sent += n;
+		}
+	}
+
+	/**
+	 * @brief Serializes a response body. Invalid UTF-8, e.g. of an echoed path, is replaced instead of throwing.
+	 */
+	static string toBody(const json& body) {
+		return body.dump(-1, ' ', false, json::error_handler_t::replace);
+	}
+
+	static void sendError(int connection, int status, const string& reason, const string& message) {
+		sendResponse(connection, status, reason, toBody(json{{"error", message}}));
+	}
+
+	/**
+	 * @brief Reads one request from the connection.
+	 *
+	 * @return false if the connection was closed or the request is malformed (an error has been sent then).
+	 */
+	static bool readRequest(int connection, string& method, string& path, string& body) {
+		string data;
+		char buffer[16384];
+		size_t headerEnd;
+		while ((headerEnd = data.find("\r\n\r\n")) == string::npos) {
+			if (data.size() > SERVER_MAX_REQUEST_BYTES) {
+				sendError(connection, 431, "Request Header Fields Too Large", "header too large");
+				return false;
+			}
+			ssize_t n = recv(connection, buffer, sizeof(buffer), 0);
+			if (n <= 0)
+				return false;
+			data.append(buffer, n);
+		}
+		size_t lineEnd = data.find("\r\n");
+		size_t methodEnd = data.find(' ');
+		size_t pathEnd = methodEnd == string::npos ? string::npos : data.find(' ', methodEnd + 1);
+		if (pathEnd == string::npos || pathEnd > lineEnd) {
+			sendError(connection, 400, "Bad Request", "malformed request line");
+			return false;
+		}
+		method = data.substr(0, methodEnd);
+		path = data.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+		size_t contentLength = 0;
+		for (size_t pos = lineEnd + 2; pos < headerEnd;) {
+			size_t end = data.find("\r\n", pos);
+			string header = data.substr(pos, end - pos);
+			pos = end + 2;
+			size_t colon = header.find(':');
+			if (colon == string::npos || strncasecmp(header.c_str(), "Content-Length", colon) != 0 || colon != strlen("Content-Length"))
+				continue;
+			try {
+				contentLength = stoul(header.substr(colon + 1));
+			} catch (const exception&) {
+				sendError(connection, 400, "Bad Request", "invalid Content-Length");
+				return false;
+			}
+		}
+		if (contentLength > SERVER_MAX_REQUEST_BYTES) {
+			sendError(connection, 413, "Payload Too Large", "request too large");
+			return false;
+		}
+		body = data.substr(headerEnd + 4);
+		while (body.size() < contentLength) {
+			ssize_t n = recv(connection, buffer, min(sizeof(buffer), contentLength - body.size()), 0);
+			if (n <= 0)
+				return false;
+			body.append(buffer, n);
+		}
+		body.resize(contentLength);
+		return true;
+	}
+
+	/**
+	 * @brief Answers one request. The caller closes the connection.
+	 */
+	void handle(int connection) {
+		timeval timeout{SERVER_TIMEOUT_IN_SEC, 0};
+		setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		string method, path, body;
+		if (!readRequest(connection, method, path, body))
+			return;
+		try {
+			if (path == "/health" && method == "GET") {
+				sendResponse(connection, 200, "OK", toBody(json{{"status", "ok"}}));
+			} else if (path == "/stats" && method == "GET") {
+				sendResponse(connection, 200, "OK", toBody(processCounters().toJson()));
+			} else if (path == "/trace" && method == "GET") {
+				sendResponse(connection, 200, "OK", toBody(chromeTraceJson()));
+			} else if (path == "/route" && method == "POST") {
+				json request = json::parse(body, nullptr, false);
+				if (request.is_discarded()) {
+					sendError(connection, 400, "Bad Request", "invalid JSON");
+				} else {
+					json result = service.route(request);
+					if (result.contains("error"))
+						sendResponse(connection, 400, "Bad Request", toBody(result));
+					else
+						sendResponse(connection, 200, "OK", toBody(result));
+				}
+			} else if (path == "/route" || path == "/health" || path == "/stats" || path == "/trace") {
+				sendError(connection, 405, "Method Not Allowed", "method not allowed");
+			} else {
+				sendError(connection, 404, "Not Found", "unknown path " + path);
+			}
+		} catch (const exception& e) {
+			sendError(connection, 500, "Internal Server Error", e.what());
+		}
+	}
+
+public:
+	explicit RoutingServer(RoutingService& _service) : service{_service} {}
+
+	RoutingServer(const RoutingServer&) = delete;
+	RoutingServer& operator=(const RoutingServer&) = delete;
+
+	~RoutingServer() {
+		if (listenSocket >= 0)
+			close(listenSocket);
+	}
+
+	/**
+	 * @brief Listens on 127.0.0.1 and answers requests until the process is stopped.
+	 *
+	 * @param port The TCP port
+	 * @param threadCount The number of workers, 0 uses one per hardware thread
+	 */
+	void serve(unsigned short port, size_t threadCount = 0) {
+		listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (listenSocket < 0)
+			throw runtime_error(string("cannot create socket: ") + strerror(errno));
+		int reuse = 1;
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if (::bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listenSocket, SOMAXCONN) < 0)
+			throw runtime_error("cannot listen on port " + to_string(port) + ": " + strerror(errno));
+		ThreadPool pool(threadCount);
+		cout << "Listening on http://127.0.0.1:" << port << " with " << pool.size() << " threads." << endl;
+		while (true) {
+			int connection = accept(listenSocket, nullptr, nullptr);
+			if (connection < 0) {
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				throw runtime_error(string("accept failed: ") + strerror(errno));
+			}
+			if (inFlight >= SERVER_CONNECTIONS_PER_WORKER * pool.size()) {
+				sendError(connection, 503, "Service Unavailable", "too many requests");
+				close(connection);
+				continue;
+			}
+			++inFlight;
+			pool.submit([this, connection]() {
+				try {
+					handle(connection);
+				} catch (const exception& e) {
+					cerr << "Request failed: " << e.what() << endl;
+				}
+				close(connection);
+				--inFlight;
+			});
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * @file RoutingService.h
+ * @brief Answers route requests given as JSON on a shared, read-only graph.
+ * The service can be called from several threads at once: every thread keeps its own QueryContext and the compiled
+ * profile and energy weights of a vehicle are built once and shared by all requests for that vehicle. Each model holds
+ * one weight per arc, so only the most recently used MODEL_CACHE_SIZE vehicles are kept.
+ */
+#pragma once
+
+#include "CompiledVehicleProfile.h"
+#include "EnergyWeight.h"
+#include "EvRouting.h"
+#include "Graph.h"
+#include "QueryContext.h"
+#include "VehicleCatalog.h"
+#include "json.hpp"
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+using namespace std;
+
+#define SNAP_RADIUS_IN_METERS 1000 // Default distance within which a coordinate is matched to an arc of the graph.
+#define MODEL_CACHE_SIZE 8 // Compiled vehicles that are kept, the least recently used one is dropped first.
+
+/**
+ * @brief The parts of a vehicle that do not change between requests.
+ */
+struct VehicleModel {
+	shared_ptr<const CompiledVehicleProfile> profile;
+	shared_ptr<const EnergyWeight> energy;
+};
+
+class RoutingService {
+private:
+	GraphSnapshot g;
+	vector<float> connectorPowers;
+	float snapRadiusInMeters;
+	WorkStealingPool* pool;
+	struct CachedModel {
+		shared_future<VehicleModel> model;
+		list<string>::iterator use; // Position of the key in recentlyUsed
+	};
+	map<string, CachedModel> models; // Keyed by the JSON of the vehicle
+	list<string> recentlyUsed; // The keys of models, the most recently used first
+	mutex modelsLock;
+
+	/**
+	 * @brief Returns the compiled vehicle, it is built by the first request that needs it.
+	 * A model that is dropped from the cache stays alive until the requests that use it are done.
+	 */
+	VehicleModel getModel(const json& vehicle, const EvCar& car) {
+		string key = vehicle.dump();
+		promise<VehicleModel> built;
+		shared_future<VehicleModel> known;
+		{
+			lock_guard<mutex> guard(modelsLock);
+			auto found = models.find(key);
+			if (found != models.end()) {
+				known = found->second.model;
+				recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->second.use);
+			} else {
+				if (models.size() >= MODEL_CACHE_SIZE) {
+					models.erase(recentlyUsed.back());
+					recentlyUsed.pop_back();
+				}
+				recentlyUsed.push_front(key);
+				models[key] = {built.get_future().share(), recentlyUsed.begin()};
+			}
+		}
+		if (known.valid()) // Wait outside the lock, so other vehicles are not blocked while this one is built
+			return known.get();
+		try {
+			VehicleModel model;
+			auto profile = make_shared<const CompiledVehicleProfile>(car, connectorPowers);
+			model.energy = make_shared<const EnergyWeight>(*g, *profile);
+			model.profile = profile;
+			built.set_value(model);
+			return model;
+		} catch (...) {
+			built.set_exception(current_exception());
+			throw;
+		}
+	}
+
+	ArcSnapResult findArc(const json& position, const string& name) const {
+		float lat = position.at("latitude").get<float>();
+		float lon = position.at("longitude").get<float>();
+		return g->snapper().snapToArcOrThrow(lat, lon, snapRadiusInMeters, name);
+	}
+
+public:
+	/**
+	 * @brief Prepares the service for the given graph and its charging parks.
+	 *
+	 * @param _graph The graph to route on
+	 * @param _snapRadiusInMeters Coordinates further away from the road network are rejected, the others are projected onto the nearest arc
+	 * @param _pool Spreads the work of each single route over several threads, see EvRouting
+	 */
+	explicit RoutingService(GraphSnapshot _graph, float _snapRadiusInMeters = SNAP_RADIUS_IN_METERS, WorkStealingPool* _pool = nullptr)
+		: g{_graph}, connectorPowers{g->connectorPowers()}, snapRadiusInMeters{_snapRadiusInMeters}, pool{_pool} {
+		g->snapper(); // Build the snapping index now instead of in the first request
+	}
+
+	/**
+	 * @brief Calculates one route.
+	 * A request looks like
+	 * {"id": 1, "origin": {"latitude": 52.39, "longitude": 13.13}, "destination": {"latitude": 48.78, "longitude": 9.19}, "vehicle": "Tesla Model 3 LR", "initialChargeInkWh": 56}
+	 * where vehicle is anything vehicleFromJson() accepts and initialChargeInkWh is optional (default 80 % of the battery).
+	 *
+	 * @param request The request
+	 * @return {"id": ..., "routes": [...], "stats": {...}} with the routes in the style of the TomTom API and the counters of
+	 * the calculation (see RouteCounters.h), or {"id": ..., "error": "..."} if the request is invalid.
+	 */
+	json route(const json& request) {
+		json result;
+		if (request.is_object() && request.contains("id"))
+			result["id"] = request["id"];
+		try {
+			ArcSnapResult from = findArc(request.at("origin"), "origin");
+			ArcSnapResult to = findArc(request.at("destination"), "destination");
+			const json& vehicle = request.at("vehicle");
+			EvCar car = vehicleFromJson(vehicle);
+			VehicleModel model = getModel(vehicle, car);
+			float initialChargeInKwh = car.currentChargeInKwh;
+			if (request.contains("initialChargeInkWh"))
+				initialChargeInKwh = min(car.maxChargeInKwh, request["initialChargeInkWh"].get<float>());
+			static thread_local QueryContext context;
+			EvRouting routing(g, model.profile, model.energy, &context, pool);
+			unique_ptr<Route> route(routing.calculateRoute(from, to, initialChargeInKwh));
+			result["routes"] = { route->toJson() };
+			result["stats"] = route->counters.toJson();
+		} catch (const exception& e) {
+			result["error"] = e.what();
+		}
+		return result;
+	}
+};
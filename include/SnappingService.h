@@ -0,0 +1,204 @@
+/**
+ * @file SnappingService.h
+ * @brief Matches coordinates to the nearest node or the nearest arc of the road network.
+ * The spatial index over all nodes is built once per graph (see Graph::snapper()) and shared by every query, so a
+ * route or a batch only pays for the lookups. Coordinates that are too far from the road network are reported as
+ * failed instead of silently returning an invalid node.
+ * Snapping to a node can end up kilometres away on a long motorway arc or on the opposite carriageway, so the start
+ * and the destination of a route are projected onto the nearest arc instead, see snapToArc().
+ */
+#pragma once
+
+#include "ArrayView.h"
+#include "ThreadPool.h"
+#include <routingkit/constants.h>
+#include <routingkit/geo_position_to_node.h>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+#define SNAP_BATCH_CHUNK 4096 // Coordinates per task of a parallel batch
+#define ARC_SNAP_REACH_IN_METERS 2000 // Arcs are found through their tail, which may be this much further away than the radius.
+#define METERS_PER_DEGREE 111195.0 // Along a meridian
+
+/**
+ * @brief The node a coordinate was matched to.
+ */
+struct SnapResult {
+	unsigned node = RoutingKit::invalid_id; // invalid_id if there is no node within the radius
+	float distanceInMeters = 0.0; // Distance between the coordinate and the node
+
+	bool ok() const {
+		return node != RoutingKit::invalid_id;
+	}
+};
+
+/**
+ * @brief The position on an arc a coordinate was projected onto.
+ * A route can start or end there in both directions of the road, see EvRouting::calculateRoute.
+ */
+struct ArcSnapResult {
+	unsigned arc = RoutingKit::invalid_id; // invalid_id if there is no arc within the radius
+	unsigned reverseArc = RoutingKit::invalid_id; // The arc in the opposite direction, invalid_id on a one-way road
+	float fraction = 0.0; // Position of the projection on arc, 0 is its tail and 1 its head
+	float latitude = 0.0; // The projected position
+	float longitude = 0.0;
+	float distanceInMeters = 0.0; // Distance between the coordinate and the projected position
+
+	bool ok() const {
+		return arc != RoutingKit::invalid_id;
+	}
+};
+
+class SnappingService {
+private:
+	RoutingKit::GeoPositionToNode finder;
+	ArrayView<float> latitude, longitude;
+	ArrayView<unsigned> firstOut, head;
+
+public:
+	SnappingService() {}
+
+	/**
+	 * @brief Builds the spatial index over the nodes.
+	 *
+	 * @param _latitude The latitude of each node
+	 * @param _longitude The longitude of each node
+	 * @param _firstOut The first outgoing arc of each node, only needed by snapToArc()
+	 * @param _head The head of each arc, only needed by snapToArc()
+	 * The arrays are not copied, they must live as long as the service.
+	 */
+	SnappingService(ArrayView<float> _latitude, ArrayView<float> _longitude, ArrayView<unsigned> _firstOut = {}, ArrayView<unsigned> _head = {})
+		: finder(_latitude.toVector(), _longitude.toVector()), latitude{_latitude}, longitude{_longitude}, firstOut{_firstOut}, head{_head} {}
+
+	/**
+	 * @brief Finds the nearest node within a radius.
+	 *
+	 * @param lat The latitude of the coordinate
+	 * @param lon The longitude of the coordinate
+	 * @param radiusInMeters Nodes that are further away are not considered
+	 * @return The node and its distance, check ok() before using the node.
+	 */
+	SnapResult snap(float lat, float lon, float radiusInMeters) const {
+		auto nearest = finder.find_nearest_neighbor_within_radius(lat, lon, radiusInMeters);
+		SnapResult result;
+		result.node = nearest.id;
+		result.distanceInMeters = nearest.id == RoutingKit::invalid_id ? 0.0f : nearest.distance;
+		return result;
+	}
+
+	/**
+	 * @brief Like snap(), but throws if there is no node within the radius.
+	 *
+	 * @param name Describes the coordinate in the error message, e.g. "origin"
+	 * @throws invalid_argument if the coordinate is too far from the road network.
+	 */
+	unsigned snapOrThrow(float lat, float lon, float radiusInMeters, const string& name) const {
+		SnapResult result = snap(lat, lon, radiusInMeters);
+		if (!result.ok())
+			throw invalid_argument(name + " is not within " + to_string(static_cast<int>(radiusInMeters)) + " m of a road");
+		return result.node;
+	}
+
+	/**
+	 * @brief Projects a coordinate onto the nearest arc within a radius.
+	 * The arcs are found through the nodes within the radius plus ARC_SNAP_REACH_IN_METERS, so a one-way arc can only
+	 * be missed if it is longer than that. The distances are measured in a local equirectangular projection, which is
+	 * exact enough for a few kilometres.
+	 *
+	 * @param lat The latitude of the coordinate
+	 * @param lon The longitude of the coordinate
+	 * @param radiusInMeters Arcs that are further away are not considered
+	 * @return The arc and the position on it, check ok() before using it.
+	 */
+	ArcSnapResult snapToArc(float lat, float lon, float radiusInMeters) const {
+		ArcSnapResult result;
+		unsigned bestTail = RoutingKit::invalid_id;
+		double bestSquared = static_cast<double>(radiusInMeters) * radiusInMeters;
+		double metersPerDegreeLon = METERS_PER_DEGREE * cos(lat * M_PI / 180.0);
+		auto toX = [&](unsigned node) { return (longitude[node] - lon) * metersPerDegreeLon; };
+		auto toY = [&](unsigned node) { return (latitude[node] - lat) * METERS_PER_DEGREE; };
+		for (auto& near : finder.find_all_nodes_within_radius(lat, lon, radiusInMeters + ARC_SNAP_REACH_IN_METERS)) {
+			unsigned tail = near.id;
+			double ax = toX(tail), ay = toY(tail);
+			for (unsigned arc = firstOut[tail]; arc < firstOut[tail + 1]; ++arc) {
+				double dx = toX(head[arc]) - ax, dy = toY(head[arc]) - ay;
+				double lengthSquared = dx * dx + dy * dy;
+				// The coordinate is the origin of the projection
+				double t = lengthSquared > 0.0 ? min(1.0, max(0.0, -(ax * dx + ay * dy) / lengthSquared)) : 0.0;
+				double px = ax + t * dx, py = ay + t * dy;
+				double squared = px * px + py * py;
+				if (squared > bestSquared || (squared == bestSquared && arc > result.arc))
+					continue;
+				bestSquared = squared;
+				bestTail = tail;
+				result.arc = arc;
+				result.fraction = t;
+				result.latitude = lat + py / METERS_PER_DEGREE;
+				result.longitude = lon + px / metersPerDegreeLon;
+			}
+		}
+		if (!result.ok())
+			return result;
+		result.distanceInMeters = sqrt(bestSquared);
+		for (unsigned arc = firstOut[head[result.arc]]; arc < firstOut[head[result.arc] + 1]; ++arc) {
+			if (head[arc] == bestTail) {
+				result.reverseArc = arc;
+				break;
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Like snapToArc(), but throws if there is no arc within the radius.
+	 *
+	 * @param name Describes the coordinate in the error message, e.g. "origin"
+	 * @throws invalid_argument if the coordinate is too far from the road network.
+	 */
+	ArcSnapResult snapToArcOrThrow(float lat, float lon, float radiusInMeters, const string& name) const {
+		ArcSnapResult result = snapToArc(lat, lon, radiusInMeters);
+		if (!result.ok())
+			throw invalid_argument(name + " is not within " + to_string(static_cast<int>(radiusInMeters)) + " m of a road");
+		return result;
+	}
+
+	/**
+	 * @brief Snaps many coordinates at once. Large batches are split into chunks that are snapped in parallel.
+	 *
+	 * @param coordinates The (latitude, longitude) of each coordinate
+	 * @param radiusInMeters Nodes that are further away are not considered
+	 * @param threadCount The number of threads for a large batch, 0 uses one per hardware thread
+	 * @return The result of each coordinate in the same order.
+	 */
+	vector<SnapResult> snapAll(const vector<pair<float, float>>& coordinates, float radiusInMeters, size_t threadCount = 0) const {
+		vector<SnapResult> results(coordinates.size());
+		auto snapChunk = [&](size_t first) {
+			size_t last = min(coordinates.size(), first + SNAP_BATCH_CHUNK);
+			for (size_t i = first; i < last; ++i)
+				results[i] = snap(coordinates[i].first, coordinates[i].second, radiusInMeters);
+		};
+		if (threadCount == 0)
+			threadCount = max(1u, thread::hardware_concurrency());
+		size_t chunks = (coordinates.size() + SNAP_BATCH_CHUNK - 1) / SNAP_BATCH_CHUNK;
+		if (chunks <= 1 || threadCount == 1) {
+			for (size_t first = 0; first < coordinates.size(); first += SNAP_BATCH_CHUNK)
+				snapChunk(first);
+			return results;
+		}
+		ThreadPool pool(min(threadCount, chunks));
+		vector<future<void>> done;
+		for (size_t first = 0; first < coordinates.size(); first += SNAP_BATCH_CHUNK)
+			done.push_back(pool.submit([&, first] { snapChunk(first); }));
+		for (auto& chunk : done)
+			chunk.get();
+		return results;
+	}
+};
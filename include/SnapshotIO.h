@@ -0,0 +1,191 @@
+/**
+ * @file SnapshotIO.h
+ * @brief Helpers to write and read the versioned binary snapshots that are cached next to their input files.
+ * Each snapshot starts with a SnapshotHeader that identifies its content and the input file it was created from,
+ * so a stale snapshot is detected and rebuilt automatically.
+ * Every array is stored as its length followed by its elements, padded to 8 bytes, so a mapped snapshot can be
+ * used in place via ArrayView without copying.
+ * A snapshot is written to a temporary file that replaces the old one only when it is complete, so neither a crash
+ * while writing nor a process that still maps the old snapshot can ever see a half-written file.
+ */
+#pragma once
+
+#include "ArrayView.h"
+#include "MappedFile.h"
+#include <routingkit/vector_io.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define SNAPSHOT_VERSION 5 // Increase this whenever the layout of any snapshot changes.
+
+struct SnapshotHeader {
+	char magic[8];
+	unsigned version;
+	unsigned long long sourceSize;
+	long long sourceModified;
+	unsigned long long snapshotSize; // The size of the whole snapshot file, a shorter file is truncated
+
+	/**
+	 * @brief Creates the header for a snapshot of the given input file.
+	 *
+	 * @param _magic Identifies the content of the snapshot (at most 7 characters)
+	 * @param source The input file the snapshot is created from. It does not need to exist.
+	 */
+	SnapshotHeader(const char* _magic, const string& source) : version{SNAPSHOT_VERSION}, sourceSize{0}, sourceModified{0}, snapshotSize{0} {
+		memset(magic, 0, sizeof(magic));
+		strncpy(magic, _magic, sizeof(magic) - 1);
+		error_code ec;
+		if (!filesystem::exists(source, ec))
+			return;
+		sourceSize = filesystem::file_size(source, ec);
+		sourceModified = filesystem::last_write_time(source, ec).time_since_epoch().count();
+	}
+
+	/**
+	 * @brief Checks whether a snapshot with this header can be used instead of parsing the source.
+	 * A snapshot without its source file is always accepted, e.g. for generated graphs.
+	 *
+	 * @param expected The header that a fresh snapshot of the source would have
+	 * @return true if the snapshot is still up to date.
+	 */
+	bool matches(const SnapshotHeader& expected) const {
+		if (memcmp(magic, expected.magic, sizeof(magic)) != 0 || version != expected.version)
+			return false;
+		if (expected.sourceSize == 0 && expected.sourceModified == 0) // source is missing
+			return true;
+		return sourceSize == expected.sourceSize && sourceModified == expected.sourceModified;
+	}
+};
+
+/**
+ * @brief Checks whether there is a valid snapshot of the given source file.
+ *
+ * @param snapshot The path of the snapshot
+ * @param magic Identifies the content of the snapshot
+ * @param source The input file the snapshot should have been created from
+ * @return true if the snapshot exists, is complete and is up to date.
+ */
+bool isSnapshotValid(const string& snapshot, const char* magic, const string& source) {
+	ifstream in(snapshot, ios::binary);
+	if (!in)
+		return false;
+	SnapshotHeader header("", "");
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!in)
+		return false;
+	error_code ec;
+	if (filesystem::file_size(snapshot, ec) != header.snapshotSize || ec)
+		return false;
+	return header.matches(SnapshotHeader(magic, source));
+}
+
+/**
+ * @brief Writes a snapshot to <snapshot>.tmp, flushes it to the disk and then renames it over the snapshot.
+ * The header is written last, with the final size of the file.
+ *
+ * @param snapshot The path of the snapshot
+ * @param header Identifies the content and the source of the snapshot
+ * @param writeBody Writes everything after the header
+ */
+void saveSnapshot(const string& snapshot, SnapshotHeader header, const function<void(ostream&)>& writeBody) {
+	string tmp = snapshot + ".tmp";
+	{
+		ofstream out(tmp, ios::binary | ios::trunc);
+		if (!out)
+			throw runtime_error("Can not open \"" + tmp + "\" for writing.");
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeBody(out);
+		header.snapshotSize = out.tellp();
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.close();
+		if (!out)
+			throw runtime_error("Could not write \"" + tmp + "\"");
+	}
+#ifndef WINDOWS
+	int fd = open(tmp.c_str(), O_RDONLY);
+	bool synced = fd >= 0 && fsync(fd) == 0;
+	if (fd >= 0)
+		close(fd);
+	if (!synced)
+		throw runtime_error("Could not flush \"" + tmp + "\" to the disk");
+#endif
+	// The old file stays intact for the processes that still map it, they keep their pages until they unmap it.
+	filesystem::rename(tmp, snapshot);
+}
+
+template<class T>
+void writeSnapshotVector(ostream& out, ArrayView<T> v) {
+	static const char padding[8] = {};
+	RoutingKit::write_value<unsigned long long>(out, v.size());
+	out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+	out.write(padding, (8 - v.size() * sizeof(T) % 8) % 8);
+	if (!out)
+		throw runtime_error("Could not write vector data");
+}
+
+template<class T>
+void writeSnapshotVector(ostream& out, const vector<T>& v) {
+	writeSnapshotVector(out, ArrayView<T>(v));
+}
+
+void writeSnapshotString(ostream& out, const string& s) {
+	writeSnapshotVector(out, ArrayView<char>(s.data(), s.size()));
+}
+
+/**
+ * @brief Reads a snapshot that has been mapped into memory.
+ * Arrays can either be viewed in place or copied.
+ */
+struct SnapshotReader {
+	const char* pos;
+	const char* end;
+
+	SnapshotReader(const MappedFile& file) : pos{file.data()}, end{file.data() + file.size()} {
+		skip(sizeof(SnapshotHeader)); // validated by isSnapshotValid
+	}
+
+	void skip(size_t bytes) {
+		if (bytes > static_cast<size_t>(end - pos))
+			throw runtime_error("Snapshot is truncated");
+		pos += bytes;
+	}
+
+	template<class T>
+	T readValue() {
+		T val;
+		const char* at = pos;
+		skip(sizeof(T));
+		memcpy(&val, at, sizeof(T));
+		return val;
+	}
+
+	template<class T>
+	ArrayView<T> viewVector() {
+		auto size = readValue<unsigned long long>();
+		const T* first = reinterpret_cast<const T*>(pos);
+		skip(size * sizeof(T));
+		skip((8 - size * sizeof(T) % 8) % 8);
+		return ArrayView<T>(first, size);
+	}
+
+	template<class T>
+	vector<T> readVector() {
+		return viewVector<T>().toVector();
+	}
+
+	string readString() {
+		ArrayView<char> chars = viewVector<char>();
+		return string(chars.begin(), chars.end());
+	}
+};
@@ -0,0 +1,47 @@
+/**
+ * @file StageTimer.h
+ * @brief Measures how long a route calculation spends in each of its stages.
+ */
+#pragma once
+
+#include <chrono>
+
+using namespace std;
+
+enum RouteStage {
+	STAGE_SNAPPING, // Matching coordinates to nodes
+	STAGE_CH_QUERY, // Shortest path searches and path unpacking
+	STAGE_CONSUMPTION, // State of charge along the paths
+	STAGE_CANDIDATE_SEARCH, // Charging parks along the route and the backtrace over them
+	STAGE_CHARGING, // Charging times at the selected parks
+	STAGE_SERIALISATION, // Conversion of the result to JSON
+	STAGE_COUNT
+};
+
+inline const char* const ROUTE_STAGE_NAMES[STAGE_COUNT] = {"snapping", "chQuery", "consumption", "candidateSearch", "charging", "serialisation"};
+
+struct StageTimes {
+	double seconds[STAGE_COUNT] = {};
+
+	double total() const {
+		double sum = 0.0;
+		for (double s : seconds)
+			sum += s;
+		return sum;
+	}
+};
+
+/**
+ * @brief Adds the time between its construction and its destruction to one stage.
+ */
+struct StageTimer {
+	StageTimes& times;
+	RouteStage stage;
+	chrono::steady_clock::time_point start;
+
+	StageTimer(StageTimes& _times, RouteStage _stage) : times{_times}, stage{_stage}, start{chrono::steady_clock::now()} {}
+
+	~StageTimer() {
+		times.seconds[stage] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+};
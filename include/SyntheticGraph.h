@@ -0,0 +1,242 @@
+/**
+ * @file SyntheticGraph.h
+ * @brief Generates a synthetic road network and charging stations, so the routing can be measured without a pbf file.
+ * The road network is a jittered grid with three road classes: a motorway on every motorwayEvery-th row and column, a
+ * primary road on every primaryEvery-th and residential roads in between. The charging stations are written in the
+ * format of the chargers.csv of gatherEVStations.py and are loaded like real ones.
+ */
+#pragma once
+
+#include "ChargerIndex.h"
+#include "Graph.h"
+#include "Point.h"
+#include "StringUtil.h"
+#include <routingkit/osm_simple.h>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct SyntheticGraphOptions {
+	unsigned rows = 200;
+	unsigned cols = 200;
+	double spacingInKm = 2.0; // Distance between neighbouring nodes of the grid
+	double originLat = 48.0, originLon = 8.0; // South-west corner of the grid
+	unsigned motorwayEvery = 20, primaryEvery = 5; // Rows and columns between two roads of the class
+	double motorwayKmh = 120, primaryKmh = 80, residentialKmh = 50;
+	double detourFactor = 1.15; // Roads are longer than the straight line between their nodes
+	unsigned chargerCount = 2000;
+	double chargersOnMajorRoads = 0.7; // Share of the charging parks of 150 kW and more that lie on a motorway or primary road
+	vector<pair<float, double>> powerMix = {{11, 0.3}, {50, 0.3}, {150, 0.25}, {300, 0.15}}; // (kW, share of the parks)
+	unsigned long seed = 1;
+
+	double areaInKm2() const {
+		return (rows - 1) * spacingInKm * (cols - 1) * spacingInKm;
+	}
+
+	/**
+	 * @brief Sets the number of charging parks from a density.
+	 *
+	 * @param parksPer1000Km2 The number of parks per 1000 km²
+	 */
+	void setChargerDensity(double parksPer1000Km2) {
+		chargerCount = static_cast<unsigned>(round(parksPer1000Km2 * areaInKm2() / 1000));
+	}
+
+	/**
+	 * @brief Parses a power mix like "11:0.3,50:0.3,150:0.25,300:0.15". The shares do not need to add up to 1.
+	 */
+	void setPowerMix(string mix) {
+		powerMix.clear();
+		for (string& entry : split(mix, ",", false)) {
+			vector<string> parts = split(entry, ":", false);
+			if (parts.size() != 2)
+				throw invalid_argument("invalid power mix entry " + entry);
+			powerMix.push_back(make_pair(stof(parts[0]), stod(parts[1])));
+		}
+		if (powerMix.empty())
+			throw invalid_argument("empty power mix");
+	}
+
+	/**
+	 * @brief Returns the options for a network of a typical size.
+	 *
+	 * @param size "city" (25 km, 2.5k nodes), "region" (200 km, 40k nodes), "country" (900 km, 640k nodes) or "continent" (3000 km, 4M nodes)
+	 */
+	static SyntheticGraphOptions preset(const string& size) {
+		SyntheticGraphOptions options;
+		if (size == "city") {
+			options.rows = options.cols = 50;
+			options.spacingInKm = 0.5;
+		} else if (size == "region") {
+			options.rows = options.cols = 200;
+			options.spacingInKm = 1.0;
+		} else if (size == "country") {
+			options.rows = options.cols = 800;
+			options.spacingInKm = 1.125;
+		} else if (size == "continent") {
+			options.rows = options.cols = 2000;
+			options.spacingInKm = 1.5;
+			options.originLat = 40.0;
+			options.originLon = -5.0;
+		} else {
+			throw invalid_argument("unknown size " + size);
+		}
+		options.setChargerDensity(50);
+		return options;
+	}
+
+	double speedOfRoad(unsigned line) const {
+		if (line % motorwayEvery == 0)
+			return motorwayKmh;
+		if (line % primaryEvery == 0)
+			return primaryKmh;
+		return residentialKmh;
+	}
+};
+
+/**
+ * @brief Generates the road network. All roads can be driven in both directions.
+ *
+ * @param options The size and the seed of the network
+ * @return The network in the format of RoutingKit's OSM loader.
+ */
+inline RoutingKit::SimpleOSMCarRoutingGraph generateSyntheticRoads(const SyntheticGraphOptions& options) {
+	if (options.rows < 2 || options.cols < 2)
+		throw invalid_argument("a synthetic graph needs at least 2 x 2 nodes");
+	if (static_cast<unsigned long long>(options.rows) * options.cols * 4 >= invalid_id)
+		throw invalid_argument("the synthetic graph is too large");
+	mt19937_64 random(options.seed);
+	uniform_real_distribution<double> jitter(-0.2, 0.2);
+	double latStep = options.spacingInKm / KM_PER_DEG;
+	double lonStep = options.spacingInKm / (KM_PER_DEG * cos(toRadians(options.originLat)));
+	RoutingKit::SimpleOSMCarRoutingGraph graph;
+	size_t nodeCount = static_cast<size_t>(options.rows) * options.cols;
+	graph.latitude.reserve(nodeCount);
+	graph.longitude.reserve(nodeCount);
+	graph.first_out.reserve(nodeCount + 1);
+	graph.head.reserve(4 * nodeCount);
+	graph.geo_distance.reserve(4 * nodeCount);
+	graph.travel_time.reserve(4 * nodeCount);
+	for (unsigned r = 0; r < options.rows; ++r) {
+		for (unsigned c = 0; c < options.cols; ++c) {
+			graph.latitude.push_back(options.originLat + (r + jitter(random)) * latStep);
+			graph.longitude.push_back(options.originLon + (c + jitter(random)) * lonStep);
+		}
+	}
+	graph.first_out.push_back(0);
+	const int dr[4] = {-1, 1, 0, 0}, dc[4] = {0, 0, -1, 1};
+	for (unsigned r = 0; r < options.rows; ++r) {
+		for (unsigned c = 0; c < options.cols; ++c) {
+			unsigned node = r * options.cols + c;
+			for (int k = 0; k < 4; ++k) {
+				long rr = long(r) + dr[k], cc = long(c) + dc[k];
+				if (rr < 0 || cc < 0 || rr >= options.rows || cc >= options.cols)
+					continue;
+				unsigned neighbour = rr * options.cols + cc;
+				// A horizontal arc belongs to the road of its row, a vertical one to the road of its column.
+				double speedInKmh = dr[k] == 0 ? options.speedOfRoad(r) : options.speedOfRoad(c);
+				double km = options.detourFactor * distance_in_km(graph.latitude[node], graph.longitude[node], graph.latitude[neighbour], graph.longitude[neighbour]);
+				graph.head.push_back(neighbour);
+				graph.geo_distance.push_back(static_cast<unsigned>(round(1000 * km)));
+				graph.travel_time.push_back(max(1u, static_cast<unsigned>(round(km / speedInKmh * 3600 * 1000)))); // in milliseconds
+			}
+			graph.first_out.push_back(graph.head.size());
+		}
+	}
+	return graph;
+}
+
+/**
+ * @brief Writes charging stations at random nodes of a road network as csv.
+ * The power of each park is drawn from options.powerMix. Fast chargers are placed on the major roads more often.
+ *
+ * @param path The file to write
+ * @param graph The road network, generated with the same options
+ * @param options The number of stations, their power and the seed
+ */
+inline void writeSyntheticChargers(string path, const RoutingKit::SimpleOSMCarRoutingGraph& graph, const SyntheticGraphOptions& options) {
+	ofstream file(path);
+	if (!file)
+		throw runtime_error("cannot write " + path);
+	mt19937_64 random(options.seed + 1);
+	uniform_int_distribution<unsigned> rowOf(0, options.rows - 1), colOf(0, options.cols - 1);
+	uniform_real_distribution<double> unit(0.0, 1.0);
+	vector<double> shares;
+	for (auto& [kw, share] : options.powerMix)
+		shares.push_back(share);
+	discrete_distribution<size_t> powerOf(shares.begin(), shares.end());
+	file.precision(10);
+	file << "id,name,entry_lat,entry_lon,lat,lon,kws,types,currentTypes\n";
+	for (unsigned i = 0; i < options.chargerCount; ++i) {
+		float kw = options.powerMix[powerOf(random)].first;
+		unsigned r = rowOf(random), c = colOf(random);
+		if (kw >= 150 && unit(random) < options.chargersOnMajorRoads) {
+			// Move the park onto the nearest major road of its row or column.
+			if (unit(random) < 0.5)
+				r = min(options.rows - 1, static_cast<unsigned>(round(double(r) / options.primaryEvery)) * options.primaryEvery);
+			else
+				c = min(options.cols - 1, static_cast<unsigned>(round(double(c) / options.primaryEvery)) * options.primaryEvery);
+		}
+		unsigned node = r * options.cols + c;
+		string kws, types, currentTypes;
+		if (kw < 50) { // AC parks also have a slow outlet
+			kws = to_string(static_cast<int>(kw)) + "|3.7";
+			types = "IEC62196Type2Outlet|StandardHouseholdCountrySpecific";
+			currentTypes = "AC3|AC1";
+		} else {
+			kws = to_string(static_cast<int>(kw)) + "|22";
+			types = "IEC62196Type2CCS|IEC62196Type2Outlet";
+			currentTypes = "DC|AC3";
+		}
+		// The park itself lies a few metres beside its entry on the road.
+		file << 100000 + i << ",Synthetic Park " << i << "," << graph.latitude[node] << "," << graph.longitude[node] << ","
+			<< graph.latitude[node] + 0.0002 << "," << graph.longitude[node] + 0.0002 << "," << kws << "," << types << "," << currentTypes << "\n";
+	}
+}
+
+/**
+ * @brief Generates a road network with charging stations and loads it like a real graph.
+ *
+ * @param options The size and the seed of the network
+ * @param charger_file The generated stations are written to this csv file and loaded from there
+ * @return GraphSnapshot that can be shared by any number of routing queries.
+ */
+inline GraphSnapshot loadSyntheticGraph(const SyntheticGraphOptions& options, string charger_file) {
+	auto g = make_shared<Graph>();
+	RoutingKit::SimpleOSMCarRoutingGraph roads = generateSyntheticRoads(options);
+	writeSyntheticChargers(charger_file, roads, options);
+	g->assignGraph(move(roads));
+	g->ch = RoutingKit::ContractionHierarchy::build(g->node_count(), g->tail.toVector(), g->head.toVector(), g->travel_time.toVector());
+	remove((charger_file + ".snapshot").c_str()); // A snapshot of an earlier run may look valid for the rewritten file.
+	g->loadChargers(charger_file);
+	return g;
+}
+
+/**
+ * @brief Generates a road network with charging stations and saves it like a parsed pbf file, so it can be loaded with
+ * Graph::load(name, name + ".chargers.csv") by any program that takes a pbf file.
+ * Writes <name>.snapshot, <name>.ch and <name>.chargers.csv. The file <name> itself must not exist, because the
+ * snapshot would be checked against it.
+ *
+ * @param options The size and the seed of the network
+ * @param name The name of the graph
+ */
+inline void saveSyntheticGraph(const SyntheticGraphOptions& options, string name) {
+	if (filesystem::exists(name))
+		throw invalid_argument(name + " exists, the synthetic graph would be checked against it");
+	Graph g;
+	RoutingKit::SimpleOSMCarRoutingGraph roads = generateSyntheticRoads(options);
+	writeSyntheticChargers(name + ".chargers.csv", roads, options);
+	g.assignGraph(move(roads));
+	g.saveGraphSnapshot(name + ".snapshot", name);
+	RoutingKit::ContractionHierarchy::build(g.node_count(), g.tail.toVector(), g.head.toVector(), g.travel_time.toVector()).save_file(name + ".ch");
+	remove((name + ".chargers.csv.snapshot").c_str());
+}
@@ -0,0 +1,92 @@
+/**
+ * @file ThreadPool.h
+ * @brief Defines a fixed pool of worker threads that run tasks from a shared queue.
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool {
+private:
+	vector<thread> workers;
+	deque<function<void()>> tasks;
+	mutex lock;
+	condition_variable wakeUp;
+	bool stopping = false;
+
+	void work() {
+		while (true) {
+			function<void()> task;
+			{
+				unique_lock<mutex> guard(lock);
+				wakeUp.wait(guard, [this] { return stopping || !tasks.empty(); });
+				if (tasks.empty()) // Only reached when stopping
+					return;
+				task = move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+public:
+	/**
+	 * @brief Starts the worker threads.
+	 *
+	 * @param threadCount The number of workers, 0 uses one per hardware thread.
+	 */
+	explicit ThreadPool(size_t threadCount = 0) {
+		if (threadCount == 0)
+			threadCount = max(1u, thread::hardware_concurrency());
+		for (size_t i = 0; i < threadCount; ++i)
+			workers.emplace_back([this] { work(); });
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Finishes all queued tasks and joins the workers.
+	 */
+	~ThreadPool() {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (thread& worker : workers)
+			worker.join();
+	}
+
+	size_t size() const {
+		return workers.size();
+	}
+
+	/**
+	 * @brief Queues a task.
+	 *
+	 * @param task The function to run on one of the workers
+	 * @return A future for the result of the task. Exceptions of the task are rethrown by its get().
+	 */
+	template<class Task>
+	auto submit(Task task) -> future<decltype(task())> {
+		auto packaged = make_shared<packaged_task<decltype(task())()>>(move(task));
+		future<decltype(task())> result = packaged->get_future();
+		{
+			lock_guard<mutex> guard(lock);
+			tasks.emplace_back([packaged] { (*packaged)(); });
+		}
+		wakeUp.notify_one();
+		return result;
+	}
+};
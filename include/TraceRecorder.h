@@ -0,0 +1,159 @@
+/**
+ * @file TraceRecorder.h
+ * @brief Records the phases of the route calculations as a timeline in the Chrome trace event format.
+ * Every thread records into its own ring buffer, which keeps the newest TRACE_BUFFER_EVENTS spans. The buffers can be
+ * dumped at any time and opened in chrome://tracing or https://ui.perfetto.dev, which shows what a slow route did
+ * without attaching a profiler. Recording is off until enableTracing() is called. Then each span costs two clock reads
+ * and a lock of the thread's own buffer, which is only contended while the buffers are dumped.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+#define TRACE_BUFFER_EVENTS 32768 // Spans kept per thread, older ones are overwritten.
+
+struct TraceEvent {
+	const char* name; // Must be a string literal, only the pointer is stored
+	int64_t startInUs;
+	int64_t durationInUs;
+	const char* argName; // Optional argument of the span, e.g. the number of candidates
+	int64_t argValue;
+};
+
+/**
+ * @brief The ring buffer of one thread. Only the owning thread writes it; the lock is only contended while it is dumped.
+ */
+struct TraceBuffer {
+	mutex lock;
+	unsigned threadId;
+	vector<TraceEvent> events;
+	size_t next = 0; // Position of the next event, events are only overwritten once it wrapped around.
+	bool wrapped = false;
+
+	void record(const TraceEvent& event) {
+		lock_guard<mutex> guard(lock);
+		if (events.empty())
+			events.resize(TRACE_BUFFER_EVENTS);
+		events[next] = event;
+		if (++next == events.size()) {
+			next = 0;
+			wrapped = true;
+		}
+	}
+};
+
+struct TraceRegistry {
+	atomic<bool> enabled{false};
+	chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+	mutex lock;
+	vector<shared_ptr<TraceBuffer>> buffers;
+
+	static TraceRegistry& instance() {
+		static TraceRegistry registry;
+		return registry;
+	}
+};
+
+inline void enableTracing(bool enabled = true) {
+	TraceRegistry::instance().enabled.store(enabled, memory_order_relaxed);
+}
+
+inline bool tracingEnabled() {
+	return TraceRegistry::instance().enabled.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the trace buffer of the calling thread. The buffer is registered on the first call of each thread.
+ */
+inline TraceBuffer& threadTraceBuffer() {
+	static thread_local shared_ptr<TraceBuffer> buffer = [] {
+		auto created = make_shared<TraceBuffer>();
+		TraceRegistry& registry = TraceRegistry::instance();
+		lock_guard<mutex> guard(registry.lock);
+		created->threadId = registry.buffers.size() + 1;
+		registry.buffers.push_back(created);
+		return created;
+	}();
+	return *buffer;
+}
+
+inline int64_t traceClockInUs() {
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - TraceRegistry::instance().epoch).count();
+}
+
+/**
+ * @brief Records the time between its construction and its destruction as one span of the calling thread.
+ */
+struct TraceSpan {
+	const char* name;
+	const char* argName;
+	int64_t argValue;
+	int64_t start;
+
+	TraceSpan(const char* _name, const char* _argName = nullptr, int64_t _argValue = 0)
+		: name{_name}, argName{_argName}, argValue{_argValue}, start{tracingEnabled() ? traceClockInUs() : -1} {}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+	/**
+	 * @brief Sets the argument of the span, e.g. a count that is only known at its end.
+	 */
+	void setArg(const char* _argName, int64_t _argValue) {
+		argName = _argName;
+		argValue = _argValue;
+	}
+
+	~TraceSpan() {
+		if (start < 0) // Tracing was off when the span started
+			return;
+		threadTraceBuffer().record({name, start, traceClockInUs() - start, argName, argValue});
+	}
+};
+
+/**
+ * @brief Returns the spans of all threads as Chrome trace events, oldest first within each thread.
+ */
+inline json chromeTraceJson() {
+	TraceRegistry& registry = TraceRegistry::instance();
+	vector<shared_ptr<TraceBuffer>> buffers;
+	{
+		lock_guard<mutex> guard(registry.lock);
+		buffers = registry.buffers;
+	}
+	json events = json::array();
+	for (auto& buffer : buffers) {
+		lock_guard<mutex> guard(buffer->lock);
+		size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+		size_t first = buffer->wrapped ? buffer->next : 0;
+		for (size_t i = 0; i < count; ++i) {
+			const TraceEvent& event = buffer->events[(first + i) % buffer->events.size()];
+			json entry = {{"name", event.name}, {"ph", "X"}, {"ts", event.startInUs}, {"dur", event.durationInUs}, {"pid", 1}, {"tid", buffer->threadId}};
+			if (event.argName != nullptr)
+				entry["args"] = {{event.argName, event.argValue}};
+			events.push_back(entry);
+		}
+	}
+	return {{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+}
+
+/**
+ * @brief Writes the spans of all threads to a file that can be opened in chrome://tracing or Perfetto.
+ *
+ * @param path The file to write
+ */
+inline void writeChromeTrace(string path) {
+	ofstream file(path);
+	file << chromeTraceJson().dump();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file VehicleCatalog.h
+ * @brief Creates vehicles from JSON, either by the name of a built-in model or from a full description.
+ */
+#pragma once
+
+#include "EvCar.h"
+#include "json.hpp"
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+using namespace std;
+
+/**
+ * @brief Returns one of the built-in vehicles (the ones listed in the README).
+ *
+ * @param model The name of the vehicle, e.g. "Tesla Model 3 LR"
+ * @return The vehicle, throws invalid_argument if the model is unknown.
+ */
+inline EvCar builtInVehicle(const string& model) {
+	if (model == "Tesla Model 3 LR") {
+		EvCar car = EvCar("Tesla Model 3 LR", 70.0, "10,10.7:50,10.7:80,13.3:120,16.3");
+		car.weight = 2019;
+		car.setChargingCurve({{ 7.0, 190 }, { 7.7, 187 }, {8.4, 182}, {9.1, 175}, {9.8, 170}, {10.5, 166}, {11.2, 162}, {11.9, 159}, {12.6, 156}, {14.0, 150}, {14.7, 148}, {15.4, 147}, {16.1, 145}, {16.8, 144}, {18.9, 138}, {19.6, 136}, {21.7, 131}, {22.4, 128}, {23.1, 126}, {23.8, 124}, {24.5, 122}, {25.2, 120}, {25.9, 118}, {26.6, 116}, {28.7, 109}, {30.8, 102}, {31.5, 99}, {32.2, 97}, {32.9, 95}, {33.6, 92}, {34.3, 90}, {35.0, 88}, {35.7, 86}, {36.4, 85}, {37.1, 83}, {37.8, 81}, {38.5, 79}, {39.2, 77}, {39.9, 75}, {40.6, 72}, {41.3, 70}, {42.0, 69}, {42.7, 67}, {43.4, 66}, {44.1, 64}, {44.8, 64}, {46.9, 60}, {50.4, 56}, {51.1, 54}, {53.9, 50}, {56.7, 45}, {59.5, 40}});
+		return car;
+	}
+	if (model == "Volkswagen ID.4") {
+		EvCar car = EvCar("Volkswagen ID.4", 77.0, "10,12.8:50,12.8:80,16.4:120,20.5");
+		car.weight = 2224;
+		car.setChargingCurve({{0.0, 122}, {3.85, 127}, {7.7, 126}, {11.55, 127}, {15.4, 127}, {19.25, 126}, {23.1, 124}, {26.95, 117}, {30.8, 108}, {34.65, 99}, {38.5, 92}, {42.35, 85}, {46.2, 75}, {50.05, 68}, {53.9, 65}, {57.75, 64}, {61.6, 60}, {65.45, 43}, {69.3, 35}, {73.15, 26}});
+		return car;
+	}
+	if (model == "Renault Zoe") {
+		EvCar car = EvCar("Renault Zoe", 52.0, "10,10.9:50,10.9:80,14.2:120,18.2");
+		car.weight = 1677;
+		car.setChargingCurve({{1.56, 44}, {2.6, 44}, {5.2, 45}, {10.4, 45}, {13.0, 46}, {15.6, 44}, {18.2, 42}, {20.8, 40}, {23.4, 39}, {26.0, 36}, {28.6, 33}, {31.2, 31}, {33.8, 29}, {36.4, 26}, {39.0, 25}, {41.6, 24}});
+		return car;
+	}
+	if (model == "Fiat 500e") {
+		EvCar car = EvCar("Fiat 500e", 37.3, "10,10.5:50,10.5:80,13.8:120,17.3");
+		car.weight = 1465;
+		car.setChargingCurve({{2.98, 72}, {3.73, 76}, {5.6, 82}, {7.46, 85}, {9.32, 82}, {11.19, 80}, {13.06, 74}, {14.92, 68}, {16.78, 67}, {18.65, 66}, {20.52, 58}, {22.38, 53}, {24.24, 53}, {26.11, 51}, {27.98, 47}, {29.84, 44}, {31.7, 15}});
+		return car;
+	}
+	throw invalid_argument("unknown vehicle model: " + model);
+}
+
+/**
+ * @brief Checks a consumption curve in the format of the EvCar constructor before the car is built from it.
+ *
+ * @param curve The curve, e.g. "10,10.7:50,10.7:80,13.3:120,16.3"
+ * @throws invalid_argument if an entry does not consist of two numbers separated by a comma, or if there are less than two entries.
+ */
+inline void checkConsumptionCurve(string curve) {
+	vector<string> entries = split(curve, ":", false);
+	for (string entry : entries) {
+		vector<string> fields = split(entry, ",", true);
+		bool numeric = fields.size() == 2;
+		for (size_t f = 0; numeric && f < fields.size(); ++f) {
+			size_t used = 0;
+			try {
+				stof(fields[f], &used);
+			} catch (const exception&) {
+				numeric = false;
+			}
+			numeric = numeric && used == fields[f].size();
+		}
+		if (!numeric)
+			throw invalid_argument("invalid consumption entry \"" + entry + "\", expected speedInKmh,consumptionInKWh");
+	}
+	if (entries.size() < 2)
+		throw invalid_argument("the consumption curve needs at least two points");
+}
+
+/**
+ * @brief Creates a vehicle from JSON.
+ * Either a string with the name of a built-in vehicle or an object like
+ * {"model": "Tesla Model 3 LR", "maxChargeInKwh": 70, "consumption": "10,10.7:50,10.7:80,13.3:120,16.3", "weight": 2019, "chargingCurve": [[7.0, 190], ...]}
+ * The optional fields chargingTimeOffsetInSec, maxChargingTimeInSec, minChargeAtDestinationInkWh and minChargeAtChargingStopsInkWh override the defaults of EvCar.
+ *
+ * @param vehicle The JSON description
+ * @return The vehicle, throws if the description is invalid.
+ */
+inline EvCar vehicleFromJson(const json& vehicle) {
+	if (vehicle.is_string())
+		return builtInVehicle(vehicle.get<string>());
+	string consumption = vehicle.at("consumption").get<string>();
+	checkConsumptionCurve(consumption);
+	EvCar car = EvCar(vehicle.at("model").get<string>(), vehicle.at("maxChargeInKwh").get<float>(), consumption);
+	car.weight = vehicle.value("weight", 0.0f);
+	if (vehicle.contains("chargingCurve")) {
+		vector<pair<float, float>> curve;
+		for (const json& point : vehicle["chargingCurve"])
+			curve.push_back(make_pair(point.at(0).get<float>(), point.at(1).get<float>()));
+		if (curve.empty())
+			throw invalid_argument("empty charging curve");
+		car.setChargingCurve(curve);
+	}
+	car.chargingTimeOffsetInSec = vehicle.value("chargingTimeOffsetInSec", car.chargingTimeOffsetInSec);
+	car.maxChargingTimeInSec = vehicle.value("maxChargingTimeInSec", car.maxChargingTimeInSec);
+	car.minChargeAtDestinationInkWh = vehicle.value("minChargeAtDestinationInkWh", car.minChargeAtDestinationInkWh);
+	car.minChargeAtChargingStopsInkWh = vehicle.value("minChargeAtChargingStopsInkWh", car.minChargeAtChargingStopsInkWh);
+	return car;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file WorkStealingPool.h
+ * @brief Defines a pool of worker threads for the small, independent tasks within a single route calculation.
+ * Every worker has its own queue and takes the newest task from it; a worker without work steals the oldest task of
+ * another worker. The thread that submits a batch of tasks works on the tasks of its batch as well until the batch is
+ * done, so a batch never waits for workers that are busy with the batches of other threads.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class WorkStealingPool {
+private:
+	struct Batch {
+		function<void(size_t, size_t)> run;
+		atomic<size_t> remaining;
+		mutex lock;
+		condition_variable done;
+	};
+
+	struct Task {
+		Batch* batch;
+		size_t index;
+	};
+
+	struct Queue {
+		mutex lock;
+		deque<Task> tasks;
+	};
+
+	vector<unique_ptr<Queue>> queues; // One per worker
+	vector<thread> workers;
+	atomic<size_t> queued{0};
+	atomic<size_t> nextQueue{0};
+	mutex sleepLock;
+	condition_variable wakeUp;
+	bool stopping = false;
+
+	bool popOwn(size_t worker, Task& task) {
+		Queue& queue = *queues[worker];
+		lock_guard<mutex> guard(queue.lock);
+		if (queue.tasks.empty())
+			return false;
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool steal(size_t thief, Task& task) {
+		for (size_t offset = 1; offset <= queues.size(); ++offset) {
+			Queue& queue = *queues[(thief + offset) % queues.size()];
+			lock_guard<mutex> guard(queue.lock);
+			if (!queue.tasks.empty()) {
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Takes a task of the given batch from any queue, the oldest of each queue first.
+	 */
+	bool takeFromBatch(const Batch& batch, Task& task) {
+		for (unique_ptr<Queue>& queue : queues) {
+			lock_guard<mutex> guard(queue->lock);
+			auto found = find_if(queue->tasks.begin(), queue->tasks.end(), [&batch](const Task& t) { return t.batch == &batch; });
+			if (found != queue->tasks.end()) {
+				task = *found;
+				queue->tasks.erase(found);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void execute(const Task& task, size_t worker) {
+		--queued;
+		task.batch->run(task.index, worker);
+		// Count down under the lock, otherwise the batch could be destroyed by run() while it is notified.
+		lock_guard<mutex> guard(task.batch->lock);
+		if (--task.batch->remaining == 0)
+			task.batch->done.notify_all();
+	}
+
+	void work(size_t worker) {
+		Task task;
+		while (true) {
+			if (popOwn(worker, task) || steal(worker, task)) {
+				execute(task, worker);
+				continue;
+			}
+			unique_lock<mutex> guard(sleepLock);
+			wakeUp.wait(guard, [this] { return stopping || queued > 0; });
+			if (stopping && queued == 0)
+				return;
+		}
+	}
+
+public:
+	/**
+	 * @brief Starts the worker threads.
+	 *
+	 * @param threadCount The number of workers, 0 uses one per hardware thread.
+	 */
+	explicit WorkStealingPool(size_t threadCount = 0) {
+		if (threadCount == 0)
+			threadCount = max(1u, thread::hardware_concurrency());
+		for (size_t i = 0; i < threadCount; ++i)
+			queues.push_back(make_unique<Queue>());
+		for (size_t i = 0; i < threadCount; ++i)
+			workers.emplace_back([this, i] { work(i); });
+	}
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	~WorkStealingPool() {
+		{
+			lock_guard<mutex> guard(sleepLock);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (thread& worker : workers)
+			worker.join();
+	}
+
+	size_t size() const {
+		return workers.size();
+	}
+
+	/**
+	 * @brief Runs the tasks 0, ..., taskCount - 1 on the pool and the calling thread and returns when all are done.
+	 * The tasks may run in any order and on any thread, so each must only write its own part of the result.
+	 *
+	 * @param taskCount The number of tasks
+	 * @param fn The task, called with its index and the worker that runs it: 0 to size() - 1 for the threads of the pool
+	 * and size() for the calling thread, which only runs tasks of its own batch. So the caller can use its own scratch
+	 * memory for the tasks it runs itself.
+	 */
+	void run(size_t taskCount, const function<void(size_t, size_t)>& fn) {
+		if (taskCount == 0)
+			return;
+		Batch batch;
+		batch.run = fn;
+		batch.remaining = taskCount;
+		size_t first = nextQueue++;
+		{
+			// Counted before the tasks are published, a worker could otherwise take one and count queued below zero.
+			lock_guard<mutex> guard(sleepLock);
+			queued += taskCount;
+		}
+		for (size_t i = 0; i < taskCount; ++i) {
+			Queue& queue = *queues[(first + i) % queues.size()];
+			lock_guard<mutex> guard(queue.lock);
+			queue.tasks.push_back({&batch, i});
+		}
+		wakeUp.notify_all();
+		// Help with the batch instead of waiting idle.
+		Task task;
+		while (batch.remaining > 0 && takeFromBatch(batch, task))
+			execute(task, size());
+		unique_lock<mutex> guard(batch.lock);
+		batch.done.wait(guard, [&batch] { return batch.remaining == 0; });
+	}
+};
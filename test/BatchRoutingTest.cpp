@@ -0,0 +1,95 @@
+/**
+ * Regression check: every line of a batch gets its result line, even if requests are malformed or need charging stops.
+ *
+ * The graph is a synthetic 200 x 200 grid with 2 km spacing and 800 charging parks. The batch mixes malformed
+ * requests (invalid JSON, missing fields, an unknown vehicle, consumption curves that cannot be parsed, a position far
+ * away from the roads) with long routes of small vehicles that stop at a park and then need another one.
+ */
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BatchRouting.h"
+#include "SyntheticGraph.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failures;
+	}
+}
+
+string routeRequest(int id, double fromLat, double fromLon, double toLat, double toLon, const string& vehicle) {
+	return "{\"id\": " + to_string(id) + ", \"origin\": {\"latitude\": " + to_string(fromLat) + ", \"longitude\": " + to_string(fromLon)
+		+ "}, \"destination\": {\"latitude\": " + to_string(toLat) + ", \"longitude\": " + to_string(toLon) + "}, \"vehicle\": " + vehicle + "}";
+}
+
+string inlineVehicle(const string& consumption) {
+	return "{\"model\": \"Inline\", \"maxChargeInKwh\": 50, \"consumption\": \"" + consumption + "\"}";
+}
+
+int main() {
+	SyntheticGraphOptions options;
+	options.rows = options.cols = 200;
+	options.spacingInKm = 2.0;
+	options.chargerCount = 800;
+	string charger_file = "batch_chargers.csv", request_file = "batch_requests.jsonl", result_file = "batch_results.ndjson";
+	RoutingService service(loadSyntheticGraph(options, charger_file));
+
+	// Each entry is a request line and whether it is malformed, so its result must be an error.
+	vector<pair<string, bool>> requests = {
+		{routeRequest(1, 50.5484, 10.8845, 51.3743, 8.6707, "\"Renault Zoe\""), false}, // Used to stop at the park it had just charged at
+		{"{\"id\": 2, \"origin\": ", true},
+		{routeRequest(3, 49.7690, 12.9925, 49.0838, 8.3849, "\"Fiat 500e\""), false},
+		{routeRequest(4, 48.5, 9.0, 49.5, 9.0, inlineVehicle("10")), true},
+		{routeRequest(5, 48.5, 9.0, 49.5, 9.0, inlineVehicle("10,10.7:50")), true},
+		{routeRequest(6, 48.5, 9.0, 49.5, 9.0, inlineVehicle("10,a:50,12")), true},
+		{routeRequest(7, 48.5, 9.0, 49.5, 9.0, inlineVehicle("10,10.7:50,10.7:80,13.3:120,16.3")), false},
+		{routeRequest(8, 48.1, 8.1, 51.5, 13.2, "\"Renault Zoe\""), false},
+		{routeRequest(9, 48.5, 9.0, 49.5, 9.0, "\"Unknown Car\""), true},
+		{"{\"id\": 10, \"origin\": {\"latitude\": 48.5, \"longitude\": 9.0}, \"vehicle\": \"Fiat 500e\"}", true},
+		{routeRequest(11, 40.0, 0.0, 49.5, 9.0, "\"Fiat 500e\""), true},
+		{routeRequest(12, 51.5, 13.2, 48.1, 8.1, "\"Fiat 500e\""), false},
+		{routeRequest(13, 48.3, 12.5, 51.2, 8.4, "\"Tesla Model 3 LR\""), false},
+	};
+	{
+		ofstream input(request_file);
+		for (auto& [line, malformed] : requests)
+			input << line << "\n\n"; // Empty lines are skipped
+	}
+	runBatch(service, request_file, result_file, 2);
+
+	vector<json> results;
+	ifstream output(result_file);
+	string line;
+	while (getline(output, line)) {
+		json result = json::parse(line, nullptr, false);
+		check(!result.is_discarded(), "result line is valid JSON: " + line);
+		results.push_back(result);
+	}
+	check(results.size() == requests.size(), "every request has a result line, got " + to_string(results.size()) + " of " + to_string(requests.size()));
+	size_t chargingRoutes = 0;
+	for (size_t r = 0; r < min(results.size(), requests.size()); ++r) {
+		const json& result = results[r];
+		string which = "result " + to_string(r + 1);
+		if (result.contains("id"))
+			check(result["id"] == r + 1, which + " is in the order of the input");
+		check(result.contains("error") == requests[r].second, which + (requests[r].second ? " reports an error" : " has a route"));
+		if (result.contains("routes") && !result["routes"][0].contains("fail") && result["routes"][0]["legs"].size() > 2)
+			++chargingRoutes;
+	}
+	check(chargingRoutes > 0, "at least one route arrives after several charging stops");
+
+	remove(request_file.c_str());
+	remove(result_file.c_str());
+	remove(charger_file.c_str());
+	remove((charger_file + ".snapshot").c_str());
+	if (failures == 0)
+		cout << "All checks passed." << endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/**
+ * Regression check: the queries of the charger index find exactly the parks that a scan of all parks finds.
+ *
+ * The catalog has random parks and parks that lie exactly on the borders of the grid cells and next to them, with
+ * powers at and just below the lowest power of each tier. findKNearest is checked for several k, distances and minimum
+ * powers, so the ring lower bound and the skipped tiers are both exercised. sweepAlongPolyline is checked with a
+ * caller that reports every park and with one that raises the minimum power to the best park found so far, like the
+ * backtrace of the route calculation.
+ */
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ChargerIndex.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failures;
+	}
+}
+
+/**
+ * @brief The distances of all parks to a point, computed once for all queries at that point.
+ */
+vector<long double> distancesFrom(const ChargerStore& chargers, pair<double, double> point) {
+	vector<long double> result(chargers.size());
+	for (unsigned park = 0; park < chargers.size(); ++park)
+		result[park] = distance_in_km(point.first, point.second, chargers.lat[park], chargers.lon[park]);
+	return result;
+}
+
+/**
+ * @brief The k nearest parks by a scan of all parks, sorted by distance and then by position in the store.
+ */
+vector<unsigned> scanKNearest(const ChargerStore& chargers, const vector<long double>& distances, size_t k, double maxDistInKm, float minKw) {
+	vector<pair<long double, unsigned>> found;
+	for (unsigned park = 0; park < chargers.size(); ++park) {
+		long double dist = distances[park];
+		if (chargers.bestKw[park] >= minKw && dist <= maxDistInKm)
+			found.push_back(make_pair(dist, park));
+	}
+	sort(found.begin(), found.end());
+	vector<unsigned> result;
+	for (size_t i = 0; i < min(k, found.size()); ++i)
+		result.push_back(found[i].second);
+	return result;
+}
+
+/**
+ * @brief The hits of each point in the order a sweep reports them, as (point, park) pairs.
+ */
+typedef vector<pair<unsigned, unsigned>> SweepHits;
+
+/**
+ * @brief Sweeps a polyline like sweepAlongPolyline by a scan of all parks.
+ *
+ * @param distances The distances of all parks to each point of the polyline
+ * @param raiseMinKw Whether the minimum power is raised to the best park found so far after each point
+ */
+SweepHits scanSweep(const ChargerStore& chargers, const vector<vector<long double>>& distances, double bufferInKm, bool raiseMinKw) {
+	SweepHits result;
+	vector<bool> reported(chargers.size(), false);
+	float minKw = 0.0;
+	for (size_t i = distances.size(); i-- > 0;) {
+		vector<pair<long double, unsigned>> hits;
+		for (unsigned park = 0; park < chargers.size(); ++park) {
+			long double dist = distances[i][park];
+			if (!reported[park] && chargers.bestKw[park] >= minKw && dist <= bufferInKm)
+				hits.push_back(make_pair(dist, park));
+		}
+		sort(hits.begin(), hits.end(), [](const pair<long double, unsigned>& a, const pair<long double, unsigned>& b) {
+			if (static_cast<double>(a.first) != static_cast<double>(b.first))
+				return static_cast<double>(a.first) < static_cast<double>(b.first);
+			return a.second < b.second;
+		});
+		for (auto& hit : hits) {
+			reported[hit.second] = true;
+			result.push_back(make_pair(static_cast<unsigned>(i), hit.second));
+			if (raiseMinKw)
+				minKw = max(minKw, chargers.bestKw[hit.second]);
+		}
+	}
+	return result;
+}
+
+SweepHits indexSweep(const ChargerIndex& index, const ChargerStore& chargers, const vector<pair<double, double>>& polyline, double bufferInKm, bool raiseMinKw) {
+	SweepHits result;
+	float minKw = 0.0;
+	index.sweepAlongPolyline(polyline.size(), [&](size_t i) { return polyline[i]; }, bufferInKm, [&](size_t position, const vector<CorridorHit>& hits) {
+		for (const CorridorHit& hit : hits) {
+			result.push_back(make_pair(static_cast<unsigned>(position), hit.park));
+			if (raiseMinKw)
+				minKw = max(minKw, chargers.bestKw[hit.park]);
+		}
+		return minKw;
+	});
+	return result;
+}
+
+int main() {
+	const double latMin = 48.0, lonMin = 8.0;
+	mt19937_64 random(7);
+	uniform_real_distribution<double> latOf(latMin, latMin + 2.0), lonOf(lonMin, lonMin + 3.0), nudge(-1e-6, 1e-6);
+	vector<float> powers = {11, 22, 49.9, 50, 149.9, 150, 299.9, 300, 350};
+	uniform_int_distribution<size_t> powerOf(0, powers.size() - 1);
+
+	ChargerStore chargers;
+	auto addPark = [&](double lat, double lon, float kw) {
+		unsigned park = chargers.size();
+		chargers.add(100000 + park, "Park " + to_string(park), lat, lon, park, {ChargingConnector("IEC62196Type2CCS", kw, "DC")});
+	};
+	addPark(latMin, lonMin, 11); // Fixes the corner of the grid, so the cell borders lie at multiples of CHARGER_INDEX_CELL_DEG
+	for (int i = 0; i < 3000; ++i)
+		addPark(latOf(random), lonOf(random), powers[powerOf(random)]);
+	for (int r = 1; r < 20; r += 3) // On the borders of the cells, on their corners and just beside them
+		for (int c = 1; c < 30; c += 4) {
+			double lat = latMin + r * CHARGER_INDEX_CELL_DEG, lon = lonMin + c * CHARGER_INDEX_CELL_DEG;
+			addPark(lat, lon, powers[powerOf(random)]);
+			addPark(lat + nudge(random), lon + 0.03, powers[powerOf(random)]);
+			addPark(lat + 0.03, lon + nudge(random), powers[powerOf(random)]);
+		}
+	ChargerIndex index;
+	index.build(chargers);
+	ChargerIndex restored;
+	restored.restore(chargers, index.latMin, index.lonMin, index.latMax, index.lonMax, index.rows, index.cols, index.cellFirst, index.order);
+
+	// Query points at random positions, on cell borders and outside of the grid.
+	vector<pair<double, double>> queries;
+	for (int i = 0; i < 200; ++i)
+		queries.push_back(make_pair(latOf(random), lonOf(random)));
+	for (int r = 0; r <= 20; r += 5)
+		for (int c = 0; c <= 30; c += 6)
+			queries.push_back(make_pair(latMin + r * CHARGER_INDEX_CELL_DEG + nudge(random), lonMin + c * CHARGER_INDEX_CELL_DEG));
+	queries.push_back(make_pair(latMin - 0.2, lonMin - 0.2));
+	queries.push_back(make_pair(latMin + 2.3, lonMin + 3.4));
+
+	vector<float> minKws = {0, 49.9, 50, 100, 150, 300, 400};
+	vector<pair<size_t, double>> limits = {{1, 50}, {5, 20}, {10, 100}, {50, 200}, {1000, 8}};
+	for (auto& [lat, lon] : queries) {
+		vector<long double> distances = distancesFrom(chargers, make_pair(lat, lon));
+		for (float minKw : minKws)
+			for (auto& [k, maxDist] : limits) {
+				Point p(lat, lon);
+				string which = "findKNearest(" + to_string(lat) + ", " + to_string(lon) + ", k " + to_string(k) + ", " + to_string(maxDist) + " km, " + to_string(minKw) + " kW)";
+				vector<unsigned> expected = scanKNearest(chargers, distances, k, maxDist, minKw);
+				check(index.findKNearest(&p, k, maxDist, minKw) == expected, which + " finds the parks of a full scan");
+				check(restored.findKNearest(&p, k, maxDist, minKw) == expected, which + " finds the same parks in a restored index");
+			}
+	}
+
+	// Polylines along a diagonal, along a cell border and a zigzag that revisits parks it has passed.
+	vector<vector<pair<double, double>>> polylines(3);
+	for (int i = 0; i <= 200; ++i) {
+		polylines[0].push_back(make_pair(latMin + 0.01 * i, lonMin + 0.015 * i));
+		polylines[1].push_back(make_pair(latMin + 5 * CHARGER_INDEX_CELL_DEG, lonMin + 0.015 * i));
+		polylines[2].push_back(make_pair(latMin + 0.5 + 0.3 * ((i / 20) % 2 == 0 ? (i % 20) / 20.0 : 1 - (i % 20) / 20.0), lonMin + 0.01 * i));
+	}
+	for (size_t l = 0; l < polylines.size(); ++l) {
+		vector<vector<long double>> distances;
+		for (auto& point : polylines[l])
+			distances.push_back(distancesFrom(chargers, point));
+		for (double buffer : {1.0, 5.0, 15.0})
+			for (bool raiseMinKw : {false, true}) {
+				string which = "sweep of polyline " + to_string(l) + " with " + to_string(buffer) + " km" + (raiseMinKw ? " and rising minimum power" : "");
+				SweepHits expected = scanSweep(chargers, distances, buffer, raiseMinKw);
+				check(!expected.empty(), which + " passes parks");
+				check(indexSweep(index, chargers, polylines[l], buffer, raiseMinKw) == expected, which + " reports the parks of a full scan");
+			}
+	}
+
+	if (failures == 0)
+		cout << "All checks passed." << endl;
+	return failures == 0 ? 0 : 1;
+}
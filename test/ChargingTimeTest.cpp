@@ -0,0 +1,124 @@
+/**
+ * Regression check: the closed-form charging times of ChargingTimeTable agree with stepping through the charging curve.
+ *
+ * The reference is the loop the charging times were calculated with before: it charges with the power of the curve at
+ * the current SoC, capped by the connector, and updates the power after every step. With one second steps it is close to
+ * the exact integral, with 30 s steps it is the old result. The checks run on the curves of the built-in vehicles and on
+ * a curve whose power drops to zero, for the tables of EvCar and of CompiledVehicleProfile.
+ */
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CompiledVehicleProfile.h"
+#include "VehicleCatalog.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failures;
+	}
+}
+
+/**
+ * @brief The charging power of the car at a SoC, interpolated linearly and constant after the last point of the curve.
+ */
+double curvePower(const EvCar& car, double soc) {
+	const vector<pair<float, float>>& curve = car.chargingCurve;
+	for (size_t i = 0; i + 1 < curve.size(); ++i)
+		if (soc < curve[i + 1].first)
+			return curve[i].second + (soc - curve[i].first) / (curve[i + 1].first - curve[i].first) * (curve[i + 1].second - curve[i].second);
+	return curve.back().second;
+}
+
+/**
+ * @brief Time of a stop that charges from soc to goalSoc in steps, including the offset, -1 if the power drops to zero.
+ */
+int steppedTimeNeeded(const EvCar& car, float kw, double soc, double goalSoc, int stepInSec) {
+	goalSoc = min<double>(goalSoc, car.maxChargeInKwh);
+	if (soc > goalSoc)
+		return 0;
+	int seconds = car.chargingTimeOffsetInSec;
+	while (soc < goalSoc) {
+		double power = min<double>(kw, curvePower(car, soc));
+		if (power <= 0)
+			return -1;
+		soc += stepInSec / 3600.0 * power;
+		seconds += stepInSec;
+	}
+	return seconds;
+}
+
+/**
+ * @brief SoC after a stop of the given time (including the offset), charged in steps and capped at the battery capacity.
+ */
+double steppedChargeAfterTime(const EvCar& car, float kw, double soc, int seconds, int stepInSec) {
+	seconds -= car.chargingTimeOffsetInSec;
+	while (seconds > 0 && soc < car.maxChargeInKwh) {
+		int step = min(seconds, stepInSec);
+		soc += step / 3600.0 * min<double>(kw, curvePower(car, soc));
+		seconds -= step;
+	}
+	return min<double>(soc, car.maxChargeInKwh);
+}
+
+void checkVehicle(const EvCar& car, const vector<float>& powers) {
+	CompiledVehicleProfile profile(car, powers);
+	for (float kw : powers) {
+		ChargingConnector conn("IEC62196Type2CCS", kw, "DC");
+		string which = car.car_model + " at " + to_string(static_cast<int>(kw)) + " kW";
+		float goal = 0.8 * car.maxChargeInKwh;
+		int previous = -1;
+		for (float soc = 0.05 * car.maxChargeInKwh; soc < goal; soc += 0.05 * car.maxChargeInKwh) {
+			int closedForm = car.time_needed(conn, soc, goal);
+			int fine = steppedTimeNeeded(car, kw, soc, goal, 1);
+			int coarse = steppedTimeNeeded(car, kw, soc, goal, 30);
+			string from = which + " from " + to_string(soc) + " kWh";
+			check(abs(closedForm - fine) <= max(3.0, 0.005 * fine), from + ": time_needed " + to_string(closedForm) + " s, stepped " + to_string(fine) + " s");
+			check(abs(closedForm - coarse) <= 30 + 0.02 * coarse, from + ": time_needed " + to_string(closedForm) + " s, old stepping " + to_string(coarse) + " s");
+			check(profile.time_needed(conn, soc, goal) == closedForm, from + ": the compiled profile agrees with the car");
+			check(previous < 0 || closedForm <= previous, from + ": starting with more charge never takes longer");
+			previous = closedForm;
+		}
+		float soc = 0.1 * car.maxChargeInKwh, last = soc;
+		for (int seconds = 0; seconds <= 2 * 3600; seconds += 60) {
+			float closedForm = car.chargeAfterTime(conn, soc, seconds);
+			double fine = steppedChargeAfterTime(car, kw, soc, seconds, 1);
+			string after = which + " after " + to_string(seconds) + " s";
+			check(fabs(closedForm - fine) <= 0.005 * car.maxChargeInKwh, after + ": chargeAfterTime " + to_string(closedForm) + " kWh, stepped " + to_string(fine) + " kWh");
+			check(profile.chargeAfterTime(conn, soc, seconds) == closedForm, after + ": the compiled profile agrees with the car");
+			check(closedForm >= last && closedForm <= car.maxChargeInKwh, after + ": the charge grows with the time and stays within the battery");
+			last = closedForm;
+		}
+		// The route caps a stop at maxChargingTimeInSec and charges what fits into that time.
+		float empty = 0.05 * car.maxChargeInKwh;
+		if (car.time_needed(conn, empty, goal) > car.maxChargingTimeInSec) {
+			float capped = car.chargeAfterTime(conn, empty, car.maxChargingTimeInSec);
+			check(capped < goal, which + ": a capped stop ends below the goal");
+			check(abs(car.time_needed(conn, empty, capped) - car.maxChargingTimeInSec) <= 1, which + ": a capped stop takes maxChargingTimeInSec");
+		}
+	}
+}
+
+int main() {
+	vector<float> powers = {11, 22, 50, 150, 300};
+	for (string model : {"Tesla Model 3 LR", "Volkswagen ID.4", "Renault Zoe", "Fiat 500e"})
+		checkVehicle(builtInVehicle(model), powers);
+
+	// The power drops to zero at 40 kWh, so the charge approaches 40 kWh but never reaches it.
+	EvCar fading("Fading", 50.0, "10,10:120,20");
+	fading.setChargingCurve({{0.0, 60}, {30.0, 60}, {40.0, 0}});
+	ChargingConnector conn("IEC62196Type2CCS", 150, "DC");
+	check(fading.time_needed(conn, 10.0, 35.0) > 0, "a SoC before the power drops to zero is reached");
+	check(fading.time_needed(conn, 10.0, 40.0) == -1, "the SoC where the power is zero is never reached");
+	check(fading.chargeAfterTime(conn, 10.0, 3600) < 40.0, "the charge stays below the SoC where the power is zero");
+	check(fading.chargeAfterTime(conn, 10.0, 10 * 3600) <= 40.0, "the charge never passes the SoC where the power is zero");
+
+	if (failures == 0)
+		cout << "All checks passed." << endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/**
+ * Regression check: a route between two components of the road network must fail instead of jumping across the gap.
+ *
+ * The graph consists of two small synthetic grids about 110 km apart (48.0/8.0 and 49.0/8.0) without any road
+ * between them. Routes within one grid must succeed, routes between the grids must fail, both between snapped
+ * positions on arcs and between nodes.
+ */
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include "EvRouting.h"
+#include "Graph.h"
+#include "SyntheticGraph.h"
+#include "VehicleCatalog.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failures;
+	}
+}
+
+/**
+ * @brief Appends the arcs and nodes of b to a, so the result has two components.
+ */
+RoutingKit::SimpleOSMCarRoutingGraph joinComponents(RoutingKit::SimpleOSMCarRoutingGraph a, const RoutingKit::SimpleOSMCarRoutingGraph& b) {
+	unsigned nodeOffset = a.latitude.size(), arcOffset = a.head.size();
+	for (size_t n = 1; n < b.first_out.size(); ++n)
+		a.first_out.push_back(b.first_out[n] + arcOffset);
+	for (unsigned head : b.head)
+		a.head.push_back(head + nodeOffset);
+	a.travel_time.insert(a.travel_time.end(), b.travel_time.begin(), b.travel_time.end());
+	a.geo_distance.insert(a.geo_distance.end(), b.geo_distance.begin(), b.geo_distance.end());
+	a.latitude.insert(a.latitude.end(), b.latitude.begin(), b.latitude.end());
+	a.longitude.insert(a.longitude.end(), b.longitude.begin(), b.longitude.end());
+	return a;
+}
+
+int main() {
+	SyntheticGraphOptions south, north;
+	south.rows = south.cols = north.rows = north.cols = 5;
+	south.spacingInKm = north.spacingInKm = 1.0;
+	north.originLat = 49.0;
+	string charger_file = "disconnected_chargers.csv";
+	ofstream(charger_file) << "id,name,entry_lat,entry_lon,lat,lon,kws,types,currentTypes\n";
+	remove((charger_file + ".snapshot").c_str());
+
+	auto g = make_shared<Graph>();
+	g->assignGraph(joinComponents(generateSyntheticRoads(south), generateSyntheticRoads(north)));
+	g->ch = RoutingKit::ContractionHierarchy::build(g->node_count(), g->tail.toVector(), g->head.toVector(), g->travel_time.toVector());
+	g->loadChargers(charger_file);
+
+	EvCar car = builtInVehicle("Tesla Model 3 LR");
+	auto profile = make_shared<const CompiledVehicleProfile>(car, g->connectorPowers());
+	EvRouting routing(g, profile);
+	const SnappingService& snapper = g->snapper();
+
+	ArcSnapResult southStart = snapper.snapToArc(48.005, 8.0, 1000), southEnd = snapper.snapToArc(48.025, 8.04, 1000);
+	ArcSnapResult northEnd = snapper.snapToArc(49.005, 8.0, 1000);
+	check(southStart.ok() && southEnd.ok() && northEnd.ok(), "all positions snap to an arc");
+
+	unique_ptr<Route> within(routing.calculateRoute(southStart, southEnd, car.currentChargeInKwh));
+	check(!within->fail && !within->route.empty(), "a route within one component arrives");
+
+	unique_ptr<Route> across(routing.calculateRoute(southStart, northEnd, car.currentChargeInKwh));
+	check(across->fail, "a route between snapped positions in different components fails");
+	check(across->lengthInMeters == 0 && across->route.empty(), "a failed route between components drives nothing");
+	check(across->toJson().value("fail", false), "the JSON of the route reports the failure");
+
+	unique_ptr<Route> betweenNodes(routing.calculateRoute(0, g->node_count() - 1, car.currentChargeInKwh));
+	check(betweenNodes->fail, "a route between nodes in different components fails");
+
+	remove(charger_file.c_str());
+	remove((charger_file + ".snapshot").c_str());
+	if (failures == 0)
+		cout << "All checks passed." << endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+/**
+ * Compiles the charging stations into the binary charger catalog of a graph, so the routing starts without parsing
+ * and snapping them.
+ *
+ * Usage:
+ *   ./CompileChargerCatalog <pbf> <chargers.csv>
+ *
+ * Writes <chargers.csv>.snapshot with the parks, the nodes they are snapped to and the charger index. The catalog is
+ * only valid for this graph; Graph::loadChargers() rebuilds it if the graph or the csv file changes. It can be deployed
+ * without the csv file.
+ */
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "Graph.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		cerr << "Usage: " << argv[0] << " <pbf> <chargers.csv>" << endl;
+		return 1;
+	}
+	string pbf_file = argv[1], charger_file = argv[2];
+	Graph g;
+	g.loadRoadNetwork(pbf_file); // The contraction hierarchy is not needed for the catalog.
+	remove((charger_file + ".snapshot").c_str()); // Always compile a fresh catalog
+	auto start_time = chrono::steady_clock::now();
+	g.loadChargers(charger_file);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	cout << "Compiled " << g.chargers.size() << " parks with " << g.chargers.connectors.size() << " connectors for " << g.node_count() << " nodes in " << seconds << " s to "
+		<< charger_file << ".snapshot" << endl;
+	return 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * Generates a synthetic road network with charging stations for reproducible performance tests.
+ *
+ * Usage:
+ *   ./GenerateSyntheticGraph <name> [options]
+ *     --size <size>                  city, region, country or continent (default region)
+ *     --grid <rows> <cols>           number of nodes instead of a size
+ *     --spacing <km>                 distance between neighbouring nodes
+ *     --parks <count>                number of charging parks
+ *     --density <parks per 1000 km²> number of charging parks relative to the area (default 50)
+ *     --power-mix <kW:share,...>     power of the parks (default 11:0.3,50:0.3,150:0.25,300:0.15)
+ *     --seed <seed>                  the same seed and options give the same files (default 1)
+ *
+ * Writes <name>.snapshot, <name>.ch and <name>.chargers.csv. The graph is loaded like a parsed pbf file, e.g. with
+ *   ./Benchmark --pbf <name> --chargers <name>.chargers.csv
+ */
+#include <iostream>
+#include <string>
+#include "SyntheticGraph.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || string(argv[1]).rfind("--", 0) == 0) {
+		cerr << "Usage: " << argv[0] << " <name> [--size city|region|country|continent] [--grid rows cols] [--spacing km] [--parks count] [--density parks per 1000 km2] [--power-mix kW:share,...] [--seed seed]" << endl;
+		return 1;
+	}
+	string name = argv[1];
+	// The size is applied first, so the other options can change single values of it.
+	string size = "region";
+	for (int a = 2; a + 1 < argc; ++a)
+		if (string(argv[a]) == "--size")
+			size = argv[a + 1];
+	SyntheticGraphOptions options = SyntheticGraphOptions::preset(size);
+	double density = 50;
+	bool explicitCount = false;
+	for (int a = 2; a < argc; ++a) {
+		string arg = argv[a];
+		auto next = [&]() -> string {
+			if (a + 1 >= argc)
+				throw invalid_argument(arg + " needs a value");
+			return argv[++a];
+		};
+		if (arg == "--size") next();
+		else if (arg == "--grid") { options.rows = stoul(next()); options.cols = stoul(next()); }
+		else if (arg == "--spacing") options.spacingInKm = stod(next());
+		else if (arg == "--parks") { options.chargerCount = stoul(next()); explicitCount = true; }
+		else if (arg == "--density") density = stod(next());
+		else if (arg == "--power-mix") options.setPowerMix(next());
+		else if (arg == "--seed") options.seed = stoul(next());
+		else throw invalid_argument("unknown option " + arg);
+	}
+	if (!explicitCount)
+		options.setChargerDensity(density);
+
+	cout << "Generating " << options.rows << " x " << options.cols << " nodes, " << options.areaInKm2() << " km², " << options.chargerCount << " charging parks..." << endl;
+	saveSyntheticGraph(options, name);
+	cout << "Wrote " << name << ".snapshot, " << name << ".ch and " << name << ".chargers.csv" << endl;
+	return 0;
+}